@@ -17,162 +17,185 @@
  */
 
 #include <WProgram.h>
-#include "digitalWriteFast.h"
 #include "GCPad_16Mhz.h"
+#include "pakcrc.h"
+
+// Joybus data line. Any port whose registers are in the low I/O space
+// (PORTB, PORTC, PORTD) works; override all four to move it.
+#ifndef JOY_PORT
+#define JOY_PORT PORTD
+#define JOY_DDR DDRD
+#define JOY_PIN PIND
+#define JOY_BIT 5
+#endif
+
+// CPU cycles in ns nanoseconds, rounded. All Joybus timing below is derived
+// from this, so the code runs at any clock V-USB supports (12 to 20MHz).
+#define JOY_CYCLES(ns) ((F_CPU / 1000UL * (ns) + 500000UL) / 1000000UL)
+
+// NOPs padding each phase of a 4us bit cell, net of the instructions
+// around them (see the cycle counts in GCPad_send and GCPad_recv)
+#define JOY_LOW_1 (JOY_CYCLES(1000) - 3)
+#define JOY_LOW_3 (JOY_CYCLES(3000) - JOY_CYCLES(1000) - 4)
+#define JOY_HIGH_1 (JOY_CYCLES(4000) - JOY_CYCLES(3000) - 12)
+#define JOY_STOP (JOY_CYCLES(1000) - 2)
+#define JOY_SAMPLE (JOY_CYCLES(1625) - 4)
+
+#if JOY_CYCLES(4000) - JOY_CYCLES(3000) < 12
+#error "Joybus timing needs F_CPU of 12MHz or more"
+#endif
 
-// DO NOT CHANGE PIN DEFINITION BELOW!!!
-// GCPad_recv and GCPad_init doesn't use digitalReadFast(), it's hardcoded there!
-// To be fixed someday...
-#define JOY_DATA_PIN 5
-
-byte raw_joy_data[64];
 byte gc_joy_data[8];
 byte n64_joy_data[4];
 
-/* DO NOT CHANGE ANYTHING IN THE FUNCTION BELOW!!!
+// Stick readings at rest, from the origin command (see GCPad_origin())
+static byte gc_origin[6] = {0x00, 0x00, 0x80, 0x80, 0x80, 0x80};
+
+// Output offset from 0x80 for each distance from the stick origin: about
+// 96 steps of real stick travel stretched to the whole 0x00..0xFF range,
+// the same scale the old map(x, 32, 223, 0, 255) used.
+static const PROGMEM byte stick_scale[129] = {
+	0, 1, 3, 4, 5, 7, 8, 9, 11, 12, 13, 15, 16, 17, 19, 20,
+	21, 23, 24, 25, 27, 28, 29, 31, 32, 33, 35, 36, 37, 39, 40, 41,
+	43, 44, 45, 47, 48, 49, 51, 52, 53, 55, 56, 57, 59, 60, 61, 63,
+	64, 65, 67, 68, 69, 71, 72, 73, 75, 76, 77, 79, 80, 81, 83, 84,
+	85, 87, 88, 89, 91, 92, 93, 95, 96, 97, 99, 100, 101, 103, 104, 105,
+	107, 108, 109, 111, 112, 113, 115, 116, 117, 119, 120, 121, 123, 124, 125, 127,
+	128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128,
+	128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128,
+	128
+};
+
+// N64 accessory (pak) handling, see N64Pad_pak_task()
+#define PAK_NONE		0
+#define PAK_INIT		1
+#define PAK_IDENT		2
+#define PAK_RUMBLE		3
+#define PAK_MEMORY		4
+
+#define PAK_STATUS_EVERY 16
+
+static byte n64_pak_state = PAK_NONE;
+static byte n64_pak_frames;
+static bool n64_rumble;
+static bool n64_rumble_sent;
+static byte n64_pak_data[33];
+
+/* Cycle counted: keep the instruction counts in sync with the JOY_* macros.
  *
- * It was specially crafted to work with an 16Mhz Atmega328/168 (ext. xtal).
+ * Sends length bytes, MSB first, then the stop bit. A bit cell starts with
+ * the cbi; a 1 goes back high after 1us, a 0 after 3us. The conditional
+ * sbi and its rjmp .+0 twin take 5 cycles either way, and both ends of the
+ * bit loop (next bit or next byte) take 10 cycles, so every cell is exactly
+ * JOY_CYCLES(4000) long.
  *
  * */
 static inline void GCPad_send(byte *cmd, byte length) {
-	byte bit = 128;
-	byte high;
-
-	pinModeFast(JOY_DATA_PIN, OUTPUT);
-
-	loop:
-
-	high = *cmd & bit;
-
-	digitalWriteFast(JOY_DATA_PIN, LOW);
-
-	if(high) {
-		asm volatile ("nop\nnop\nnop\nnop\nnop\n");
-		asm volatile ("nop\nnop\n");
-		digitalWriteFast(JOY_DATA_PIN, HIGH);
-
-		bit >>= 1;
-
-		if(bit < 1) {
-			bit = 128;
-			cmd++;
-			length--;
-
-			asm volatile ("nop\nnop\nnop\nnop\nnop\nnop\n");
-			asm volatile ("nop\nnop\nnop\nnop\nnop\nnop\n");
-			asm volatile ("nop\nnop\n");
-		} else {
-			asm volatile ("nop\nnop\nnop\nnop\nnop\n");
-			asm volatile ("nop\nnop\nnop\nnop\nnop\n");
-			asm volatile ("nop\nnop\nnop\nnop\nnop\n");
-			asm volatile ("nop\nnop\nnop\nnop\nnop\n");
-		}
-
-		asm volatile ("nop\nnop\nnop\nnop\nnop\n");
-		asm volatile ("nop\nnop\nnop\nnop\nnop\n");
-		asm volatile ("nop\nnop\nnop\n");
-	} else {
-		asm volatile ("nop\nnop\nnop\n");
-		asm volatile ("nop\nnop\nnop\n");
-		asm volatile ("nop\nnop\nnop\n");
-		asm volatile ("nop\nnop\nnop\n");
-
-		bit >>= 1;
-
-		if(bit < 1) {
-			bit = 128;
-			cmd++;
-			length--;
-
-			asm volatile ("nop\nnop\nnop\nnop\nnop\nnop\n");
-			asm volatile ("nop\nnop\nnop\nnop\nnop\nnop\n");
-			asm volatile ("nop\nnop\n");
-		} else {
-			asm volatile ("nop\nnop\nnop\nnop\nnop\n");
-			asm volatile ("nop\nnop\nnop\nnop\nnop\n");
-			asm volatile ("nop\nnop\nnop\nnop\nnop\n");
-			asm volatile ("nop\nnop\nnop\nnop\n");
-		}
+	byte data, count;
 
-		digitalWriteFast(JOY_DATA_PIN, HIGH);
+	JOY_DDR |= _BV(JOY_BIT);
 
-		asm volatile ("nop\nnop\n");
-		asm volatile ("nop\nnop\n");
-		asm volatile ("nop\nnop\n");
-		asm volatile ("nop\nnop\n");
-		asm volatile ("nop\nnop\n");
-	}
-
-	if(length > 0) goto loop;
-
-	asm volatile ("nop\n");
-	asm volatile ("nop\n");
-
-	// Final stop bit (1)
-
-	digitalWriteFast(JOY_DATA_PIN, LOW);
-	asm volatile ("nop\nnop\nnop\nnop\nnop\nnop\n");
-	asm volatile ("nop\nnop\nnop\nnop\nnop\nnop\n");
-	asm volatile ("nop\nnop\n");
-	digitalWriteFast(JOY_DATA_PIN, HIGH);
+	asm volatile (
+			"ld %[data], %a[cmd]+\n"
+			"ldi %[count], 8\n"
+			"1:\n"
+			"cbi %[port], %[bit]\n"
+			".rept %[low_1]\nnop\n.endr\n"
+			"sbrc %[data], 7\n"
+			"sbi %[port], %[bit]\n"	// 1: high after 1us
+			"sbrs %[data], 7\n"
+			"rjmp .+0\n"
+			".rept %[low_3]\nnop\n.endr\n"
+			"sbi %[port], %[bit]\n"	// 0: high after 3us
+			".rept %[high_1]\nnop\n.endr\n"
+			"lsl %[data]\n"
+			"dec %[count]\n"
+			"brne 2f\n"
+			"ld %[data], %a[cmd]+\n"
+			"ldi %[count], 8\n"
+			"dec %[length]\n"
+			"breq 3f\n"
+			"rjmp 1b\n"
+			"2:\n"
+			"nop\nnop\nnop\nnop\n"
+			"rjmp 1b\n"
+			"3:\n"
+			"nop\n"
+			"cbi %[port], %[bit]\n"	// stop bit (1)
+			".rept %[stop]\nnop\n.endr\n"
+			"sbi %[port], %[bit]\n"
+			: [cmd] "+e" (cmd), [length] "+r" (length),
+			  [data] "=&r" (data), [count] "=&d" (count)
+			: [port] "I" (_SFR_IO_ADDR(JOY_PORT)), [bit] "I" (JOY_BIT),
+			  [low_1] "n" (JOY_LOW_1), [low_3] "n" (JOY_LOW_3),
+			  [high_1] "n" (JOY_HIGH_1), [stop] "n" (JOY_STOP)
+			: "memory"
+	);
 }
 
-/* DO NOT CHANGE ANYTHING IN THE FUNCTION BELOW!!!
+/* Cycle counted: keep the instruction counts in sync with the JOY_* macros.
+ *
+ * Receives length bytes, MSB first, shifting each bit straight into the
+ * output byte. The line is sampled JOY_CYCLES(1625) after the falling edge
+ * is seen (3 cycles leaving the wait, JOY_SAMPLE NOPs and the lsl), which
+ * is the 26 cycles the original 16MHz code used. The packing work after the
+ * sample fits before the line rises on a 0 bit (3us).
  *
- * It was specially crafted to work with a 16Mhz Atmega328/168 (ext. xtal).
+ * Each wait for an edge gives up after 256 rounds of 5 cycles (80us at
+ * 16MHz), far longer than any gap in a reply, so a pad pulled out or not
+ * answering can't hang the read with interrupts off. Returns false then,
+ * with the buffer partly filled.
  *
  * */
-static inline void GCPad_recv(byte *buffer, byte bits) {
-
-	pinModeFast(JOY_DATA_PIN, INPUT);
-	digitalWriteFast(JOY_DATA_PIN, HIGH);
-
-	loop:
-
-	while(PIND & 0x20);
-
+static inline bool GCPad_recv(byte *buffer, byte length) {
+	byte data, count, wait;
 
-//	asm volatile (
-//			"nop\nnop\nnop\nnop\nnop\nnop\nnop\nnop\n"
-//			"nop\nnop\nnop\nnop\nnop\n"
-//	);
-//
-//	asm volatile (
-//			"nop\nnop\nnop\nnop\nnop\nnop\nnop\nnop\n"
-//			"nop\nnop\nnop\nnop\nnop\n"
-//	);
+	JOY_DDR &= ~_BV(JOY_BIT);
+	JOY_PORT |= _BV(JOY_BIT);
 
 	asm volatile (
-			"nop\nnop\nnop\nnop\nnop\nnop\nnop\nnop\n"
-			"nop\nnop\nnop\nnop\n"
+			"ldi %[count], 8\n"
+			"1:\n"
+			"ldi %[wait], 0\n"
+			"4:\n"
+			"sbis %[pin], %[bit]\n"	// wait for the falling edge
+			"rjmp 5f\n"
+			"dec %[wait]\n"
+			"brne 4b\n"
+			"rjmp 3f\n"			// timed out, length left non zero
+			"5:\n"
+			".rept %[sample]\nnop\n.endr\n"
+			"lsl %[data]\n"
+			"sbic %[pin], %[bit]\n"	// sample
+			"ori %[data], 1\n"
+			"dec %[count]\n"
+			"brne 2f\n"
+			"st %a[buffer]+, %[data]\n"
+			"ldi %[count], 8\n"
+			"dec %[length]\n"
+			"breq 3f\n"
+			"2:\n"
+			"ldi %[wait], 0\n"
+			"6:\n"
+			"sbic %[pin], %[bit]\n"	// wait for the line to go back high
+			"rjmp 1b\n"
+			"dec %[wait]\n"
+			"brne 6b\n"
+			"3:\n"
+			: [buffer] "+e" (buffer), [length] "+r" (length),
+			  [data] "=&d" (data), [count] "=&d" (count), [wait] "=&d" (wait)
+			: [pin] "I" (_SFR_IO_ADDR(JOY_PIN)), [bit] "I" (JOY_BIT),
+			  [sample] "n" (JOY_SAMPLE)
+			: "memory"
 	);
 
-	asm volatile (
-			"nop\nnop\nnop\nnop\nnop\nnop\nnop\nnop\n"
-			"nop\nnop\nnop\nnop\n"
-	);
-
-	*buffer = PIND & 0x20; //*buffer = digitalReadFast(JOY_DATA_PIN);
-
-	buffer++;
-	bits--;
-
-	if(bits == 0)
-		return;
-
-	while(!(PIND & 0x20));
-
-    goto loop;
+	return !length;
 }
 
 byte GCPad_init() {
 	byte init = 0x00;
 	byte timeout = 64;
 
-	for(int x = 0; x < 64; x++) {
-		raw_joy_data[x] = 0x00;
-	}
-
 	for(int x = 0; x < 8; x++) {
 		gc_joy_data[x] = 0x00;
 	}
@@ -181,14 +204,19 @@ byte GCPad_init() {
 		n64_joy_data[x] = 0x00;
 	}
 
+	// A new pad: probe its pak again
+	n64_pak_state = PAK_NONE;
+	n64_pak_frames = 0;
+	n64_rumble_sent = false;
+
 	noInterrupts();
 
 	GCPad_send(&init, 1);
 
-	pinModeFast(JOY_DATA_PIN, INPUT);
-	digitalWriteFast(JOY_DATA_PIN, HIGH);
+	JOY_DDR &= ~_BV(JOY_BIT);
+	JOY_PORT |= _BV(JOY_BIT);
 
-	while((PIND & 0x20) && (--timeout));
+	while((JOY_PIN & _BV(JOY_BIT)) && (--timeout));
 
 	interrupts();
 
@@ -198,68 +226,222 @@ byte GCPad_init() {
 	return timeout;
 }
 
-byte *GCPad_read() {
-	int bit;
-
-	byte cmd[3] = {0x40, 0x03, 0x00};
+// Reads the stick origins with command 0x41 (10 byte reply, laid out like
+// the poll reply). GameCube pads only: an N64 pad wouldn't answer. Without
+// a reply the previous origins are kept.
+bool GCPad_origin() {
+	byte cmd[1] = {0x41};
+	byte origin[10];
+	bool ok;
 
 	noInterrupts();
 
-	GCPad_send(cmd, 3);
-	GCPad_recv(raw_joy_data, 64);
+	GCPad_send(cmd, 1);
+	ok = GCPad_recv(origin, 10);
 
 	interrupts();
 
-	bit = 7;
+	// Let the pad finish its stop bit before the next command
+	delayMicroseconds(20);
 
-	for(int i = 0; i < 8; i++) {
-		for(int j = 0; j < 8; j++) {
+	if(!ok)
+		return false;
 
-			if(raw_joy_data[8 * i + j] != 0 ) {
-				gc_joy_data[i] |= (1 << bit);
-			} else {
-				gc_joy_data[i] &= ~(1 << bit);
-			}
+	for(byte i = GC_STICK_X; i <= GC_C_Y; i++) {
+		gc_origin[i] = origin[i];
+	}
 
-			bit--;
+	return true;
+}
 
-			if(bit < 0)
-				bit = 7;
-		}
+// Scales a distance from the stick origin to 0x00..0xFF, 0x80 at rest
+static byte stick_axis(int distance) {
+	byte offset;
+
+	if(distance < 0) {
+		offset = pgm_read_byte(&stick_scale[(distance < -128) ? 128 : -distance]);
+		return 0x80 - offset;
 	}
 
-	return gc_joy_data;
+	offset = pgm_read_byte(&stick_scale[(distance > 127) ? 127 : distance]);
+	return 0x80 + ((offset > 0x7F) ? 0x7F : offset);
 }
 
-byte *N64Pad_read() {
-	int bit;
+byte GCPad_axis(byte axis, bool invert) {
+	int distance = gc_joy_data[axis] - gc_origin[axis];
+
+	return stick_axis(invert ? -distance : distance);
+}
+
+// Returns the poll reply, or 0 if the pad didn't answer (unplugged)
+byte *GCPad_read() {
+	byte cmd[3] = {0x40, 0x03, 0x00};
+	bool ok;
+
+	noInterrupts();
+
+	GCPad_send(cmd, 3);
+	ok = GCPad_recv(gc_joy_data, 8);
+
+	interrupts();
 
+	return ok ? gc_joy_data : 0;
+}
+
+// Returns the poll reply, or 0 if the pad didn't answer (unplugged)
+byte *N64Pad_read() {
 	byte cmd[1] = {0x01};
+	bool ok;
 
 	noInterrupts();
 
 	GCPad_send(cmd, 1);
-	GCPad_recv(raw_joy_data, 32);
+	ok = GCPad_recv(n64_joy_data, 4);
 
 	interrupts();
 
-	bit = 7;
+	return ok ? n64_joy_data : 0;
+}
 
-	for(int i = 0; i < 4; i++) {
-		for(int j = 0; j < 8; j++) {
+// Returns the status byte: bit 0 is set while a pak is inserted. No reply
+// reads as no pak.
+byte N64Pad_status() {
+	byte cmd[1] = {0x00};
+	byte status[3];
+	bool ok;
 
-			if(raw_joy_data[8 * i + j] != 0 ) {
-				n64_joy_data[i] |= (1 << bit);
-			} else {
-				n64_joy_data[i] &= ~(1 << bit);
-			}
+	noInterrupts();
+
+	GCPad_send(cmd, 1);
+	ok = GCPad_recv(status, 3);
 
-			bit--;
+	interrupts();
+
+	return ok ? status[2] : 0;
+}
+
+// Reads a 32 byte block at address into data, true if its CRC matches
+bool N64Pad_pak_read(word address, byte *data) {
+	word crc_address = pak_address(address);
+	byte cmd[3] = {0x02, crc_address >> 8, crc_address & 0xFF};
+	bool ok;
+
+	noInterrupts();
+
+	GCPad_send(cmd, 3);
+	ok = GCPad_recv(n64_pak_data, 33);
+
+	interrupts();
+
+	memcpy(data, n64_pak_data, 32);
+
+	return ok && pak_data_crc(data) == n64_pak_data[32];
+}
 
-			if(bit < 0)
-				bit = 7;
+// Writes a 32 byte block at address, true if the pak acknowledged it
+bool N64Pad_pak_write(word address, byte *data) {
+	word crc_address = pak_address(address);
+	byte cmd[35];
+	byte crc;
+	bool ok;
+
+	cmd[0] = 0x03;
+	cmd[1] = crc_address >> 8;
+	cmd[2] = crc_address & 0xFF;
+	memcpy(cmd + 3, data, 32);
+
+	noInterrupts();
+
+	GCPad_send(cmd, 35);
+	ok = GCPad_recv(&crc, 1);
+
+	interrupts();
+
+	return ok && pak_data_crc(data) == crc;
+}
+
+// N64 sticks are signed and zeroed by the pad itself at power up
+byte N64Pad_axis(byte axis, bool invert) {
+	int distance = (signed char) n64_joy_data[axis];
+
+	return stick_axis(invert ? -distance : distance);
+}
+
+void N64Pad_rumble(bool on) {
+	n64_rumble = on;
+}
+
+/* True if the next N64Pad_pak_task() call moves a pak block. A block read
+ * or write keeps interrupts off for up to ~1.2ms (35 bytes out or 33 in at
+ * 32us each, plus up to 80us waiting for the reply), so it has to fall in
+ * the quiet time right after a host poll: the loop makes sure the next pass
+ * starts on one whenever this is set (see n64_loop()). Status polls take
+ * ~150us, like a button poll, and need nothing special.
+ * */
+bool N64Pad_pak_due() {
+	return n64_pak_state == PAK_INIT || n64_pak_state == PAK_IDENT ||
+			(n64_pak_state == PAK_RUMBLE && n64_rumble != n64_rumble_sent);
+}
+
+/* Runs at most one pak transaction per call, so call it once per frame
+ * right after N64Pad_read(): the button report rate stays the same while
+ * the pak is probed or the motor is switched. Call it before N64Pad_rumble()
+ * so it does what N64Pad_pak_due() announced on the last pass.
+ *
+ * A pak is identified by writing 0x80 to 0x8000 and reading it back: a
+ * Rumble Pak returns 0x80, a Controller Pak doesn't. The motor is then
+ * driven through 0xC000. While idle, the status is polled every
+ * PAK_STATUS_EVERY frames to notice the pak being pulled.
+ * */
+void N64Pad_pak_task() {
+	byte block[32];
+
+	// Give the controller a moment after the previous transaction
+	delayMicroseconds(20);
+
+	switch(n64_pak_state) {
+	case PAK_NONE:
+		if(++n64_pak_frames < PAK_STATUS_EVERY)
+			break;
+
+		n64_pak_frames = 0;
+
+		if(N64Pad_status() & 0x01)
+			n64_pak_state = PAK_INIT;
+		break;
+	case PAK_INIT:
+		memset(block, 0x80, sizeof(block));
+		N64Pad_pak_write(0x8000, block);
+		n64_pak_state = PAK_IDENT;
+		break;
+	case PAK_IDENT:
+		if(!N64Pad_pak_read(0x8000, block)) {
+			n64_pak_state = PAK_NONE;
+		} else if(block[0] == 0x80) {
+			n64_rumble_sent = !n64_rumble; // sync the motor state
+			n64_pak_state = PAK_RUMBLE;
+		} else {
+			n64_pak_state = PAK_MEMORY;
 		}
-	}
+		break;
+	case PAK_RUMBLE:
+		if(n64_rumble != n64_rumble_sent) {
+			memset(block, n64_rumble ? 0x01 : 0x00, sizeof(block));
+
+			if(N64Pad_pak_write(0xC000, block))
+				n64_rumble_sent = n64_rumble;
+
+			break;
+		}
+		// fall through: check the pak is still there
+	case PAK_MEMORY:
+		if(++n64_pak_frames < PAK_STATUS_EVERY)
+			break;
+
+		n64_pak_frames = 0;
 
-	return n64_joy_data;
+		if(!(N64Pad_status() & 0x01))
+			n64_pak_state = PAK_NONE;
+		break;
+	}
 }
@@ -19,10 +19,33 @@
 #ifndef GCPAD_H_
 #define GCPAD_H_
 
+// Stick bytes in the GameCube and N64 poll replies, for GCPad_axis() and
+// N64Pad_axis()
+#define GC_STICK_X	2
+#define GC_STICK_Y	3
+#define GC_C_X		4
+#define GC_C_Y		5
+#define N64_STICK_X	2
+#define N64_STICK_Y	3
+
+// Button bits of the first two reply bytes, without the bits that are
+// always set or only flag events (GC origin, N64 reset)
+#define GC_BUTTONS	0x1F7F
+#define N64_BUTTONS	0xFF3F
+
 static inline void GCPad_send(byte *cmd, byte length);
-static inline void GCPad_recv(byte *buffer, byte bits);
+static inline bool GCPad_recv(byte *buffer, byte length);
 byte GCPad_init();
+bool GCPad_origin();
+byte GCPad_axis(byte axis, bool invert);
 byte *GCPad_read();
 byte *N64Pad_read();
+byte N64Pad_axis(byte axis, bool invert);
+byte N64Pad_status();
+bool N64Pad_pak_read(word address, byte *data);
+bool N64Pad_pak_write(word address, byte *data);
+void N64Pad_rumble(bool on);
+bool N64Pad_pak_due();
+void N64Pad_pak_task();
 
 #endif /* GCPAD_H_ */
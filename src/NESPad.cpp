@@ -20,40 +20,186 @@
 #include "NESPad.h"
 #include "digitalWriteFast.h"
 
-int NESPad::_clock, NESPad::_latch, NESPad::_data;
+int NESPad::_clock, NESPad::_latch, NESPad::_io;
+volatile uint8_t *NESPad::_in, *NESPad::_in2, *NESPad::_clock_pin;
+uint8_t NESPad::_mask, NESPad::_mask2, NESPad::_clock_mask;
+int NESPad::_second;
 
-void NESPad::init(int clock, int latch, int data) {
+// Stands in for a missing second data line: always high, nothing pressed
+static volatile uint8_t no_line = 0xFF;
+
+void NESPad::init(int clock, int latch, int data, int data2, int io) {
 	_clock = clock;
 	_latch = latch;
-	_data = data;
+	_io = io;
 
 	pinModeFast(_clock, OUTPUT);
 	pinModeFast(_latch, OUTPUT);
-	pinModeFast(_data, INPUT);
+	pinModeFast(data, INPUT);
 
 	// Turns data pin pull-out resistor ON
-	digitalWriteFast(_data, HIGH);
+	digitalWriteFast(data, HIGH);
+
+	// Data lines are read straight from their PIN registers, so sampling the
+	// second pad only costs a load and a test per bit
+	_in = portInputRegister(digitalPinToPort(data));
+	_mask = digitalPinToBitMask(data);
+
+	_clock_pin = portInputRegister(digitalPinToPort(clock));
+	_clock_mask = digitalPinToBitMask(clock);
+
+	_in2 = &no_line;
+	_mask2 = 0x01;
+	_second = 0;
+
+	if(data2 >= 0) {
+		pinModeFast(data2, INPUT);
+		digitalWriteFast(data2, HIGH);
+
+		_in2 = portInputRegister(digitalPinToPort(data2));
+		_mask2 = digitalPinToBitMask(data2);
+	}
+
+	if(io >= 0) {
+		pinModeFast(io, OUTPUT);
+		digitalWriteFast(io, HIGH);
+	}
+}
+
+void NESPad::latch() {
+	digitalWriteFast(_latch, LOW);
+	digitalWriteFast(_clock, LOW);
+
+	digitalWriteFast(_latch, HIGH);
+	delayMicroseconds(1);
+	digitalWriteFast(_latch, LOW);
+}
+
+// Shifts bits in from both data lines, first bit in bit 0, 1 = pressed (line
+// low). After a latch the first bit is on the lines already; clock_first
+// clocks it in when continuing a longer stream.
+void NESPad::shift_in(int bits, bool clock_first, int *state, int *state2) {
+	int s = 0, s2 = 0, bit = 1, i;
+
+	for (i = 0; i < bits; i++) {
+		if (i || clock_first) {
+			digitalWriteFast(_clock, HIGH);
+			delayMicroseconds(1);
+			digitalWriteFast(_clock, LOW);
+		}
+
+		if (!(*_in & _mask))
+			s |= bit;
+		if (!(*_in2 & _mask2))
+			s2 |= bit;
+
+		bit <<= 1;
+	}
+
+	*state = s;
+	*state2 = s2;
 }
 
 int NESPad::read(int bits) {
-	int state, i;
+	int state;
+
+	latch();
+	shift_in(bits, false, &state, &_second);
+
+	return state;
+}
+
+// Reads pads 1 to 4 of a Four Score. Without one (no signature), pads 1 and
+// 2 are the pads on data and data2 and pads 3 and 4 read as released.
+bool NESPad::read_four_score(int *pads) {
+	int state, state2, sig, sig2;
+
+	latch();
+	shift_in(16, false, &state, &state2);
+	shift_in(8, true, &sig, &sig2);
+
+	pads[0] = state & 0xFF;
+	pads[1] = state2 & 0xFF;
+
+	if (sig != NESPAD_FOUR_SCORE_SIG || sig2 != NESPAD_FOUR_SCORE_SIG2) {
+		pads[2] = pads[3] = 0;
+		return false;
+	}
+
+	pads[2] = (state >> 8) & 0xFF;
+	pads[3] = (state2 >> 8) & 0xFF;
+
+	return true;
+}
+
+// Reads pads 1 to 4 of a SNES multitap on the io line. Without one, pads 1
+// and 2 are the pads on data and data2 and pads 3 and 4 read as released.
+bool NESPad::read_multitap(int *pads) {
+	bool tap;
 
 	digitalWriteFast(_latch, LOW);
 	digitalWriteFast(_clock, LOW);
 
 	digitalWriteFast(_latch, HIGH);
 	delayMicroseconds(1);
+	tap = _io >= 0 && !(*_in2 & _mask2);
 	digitalWriteFast(_latch, LOW);
 
-	state = digitalReadFast(_data);
+	shift_in(16, false, &pads[0], &pads[1]);
 
-	for (i = 1; i < bits; i++) {
-		digitalWriteFast(_clock, HIGH);
-		delayMicroseconds(1);
-		digitalWriteFast(_clock, LOW);
+	if (tap) {
+		digitalWriteFast(_io, LOW);
+		shift_in(16, false, &pads[2], &pads[3]);
+		digitalWriteFast(_io, HIGH);
 
-		state = state | (digitalReadFast(_data) << i);
+		// A lone pad on data2 holding B also pulls it low while latched, but
+		// past its 16 bits it reads all pressed, not a zero ID nibble
+		tap = !((pads[2] | pads[3]) & 0xF000);
 	}
 
-	return ~state;
+	if (!tap)
+		pads[2] = pads[3] = 0;
+
+	return tap;
+}
+
+// One bit of read_chain(): sample both lines, then a clock pulse (two
+// toggles of the clock pin) to shift the next bit out
+#define NESPAD_CHAIN_BIT(bit) \
+	if (!(*in & mask)) \
+		b |= bit; \
+	if (!(*in2 & mask2)) \
+		b2 |= bit; \
+	*clock = clock_mask; \
+	*clock = clock_mask;
+
+// Reads count bytes of a shift register chain on data, first bit in bit 0 of
+// bytes[0], 1 = pressed. second() gets the first 16 bits of data2.
+void NESPad::read_chain(uint8_t *bytes, uint8_t count) {
+	volatile uint8_t *in = _in, *in2 = _in2, *clock = _clock_pin;
+	uint8_t mask = _mask, mask2 = _mask2, clock_mask = _clock_mask;
+	uint8_t b, b2, i;
+
+	latch();
+
+	_second = 0;
+
+	for (i = 0; i < count; i++) {
+		b = 0;
+		b2 = 0;
+
+		NESPAD_CHAIN_BIT(0x01)
+		NESPAD_CHAIN_BIT(0x02)
+		NESPAD_CHAIN_BIT(0x04)
+		NESPAD_CHAIN_BIT(0x08)
+		NESPAD_CHAIN_BIT(0x10)
+		NESPAD_CHAIN_BIT(0x20)
+		NESPAD_CHAIN_BIT(0x40)
+		NESPAD_CHAIN_BIT(0x80)
+
+		bytes[i] = b;
+
+		if (i < 2)
+			_second |= b2 << (i * 8);
+	}
 }
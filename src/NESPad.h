@@ -51,9 +51,9 @@ SNES Clock pulse and corresponding button
     X
     L
     R
-    [no button, always high]
-    [no button, always high]
-    [no button, always high]
+    [no button, always high]
+    [no button, always high]
+    [no button, always high]
 16  [no button, always high]
 */
 
@@ -62,14 +62,46 @@ SNES Clock pulse and corresponding button
 
 #include <WProgram.h>
 
+/*
+ * A second pad can share clock and latch with the first one on its own data
+ * line (data2). Both lines are sampled on the same clock pulses, and the
+ * second pad's buttons are available through second() after each read().
+ *
+ * The same two lines carry four pads through a tap, read in one pass:
+ *
+ * NES Four Score: 24 bits per line, pads 1 and 3 then the signature 0x08 on
+ * data, pads 2 and 4 then the signature 0x04 on data2.
+ *
+ * SNES multitap: with io high, pads 1 and 2 on data and data2, then with io
+ * low 16 more bits with pads 3 and 4. While latched, a multitap holds data2
+ * low, and its pads report a zero ID nibble (bits 12-15).
+ *
+ * read_chain() reads a longer chain of shift registers (arcade 74HC165s) a
+ * byte at a time. It clocks by writing the clock pin's PIN register, which
+ * toggles the pin in one instruction without touching the rest of the port
+ * (shared with V-USB), so the 125ns clock pulses need no delay.
+ */
+#define NESPAD_FOUR_SCORE_SIG	0x08
+#define NESPAD_FOUR_SCORE_SIG2	0x04
+
 class NESPad {
 
 private:
-	static int _clock, _latch, _data;
+	static int _clock, _latch, _io;
+	static volatile uint8_t *_in, *_in2, *_clock_pin;
+	static uint8_t _mask, _mask2, _clock_mask;
+	static int _second;
+
+	static void latch();
+	static void shift_in(int bits, bool clock_first, int *state, int *state2);
 
 public:
-	static void init(int clock, int latch, int data);
+	static void init(int clock, int latch, int data, int data2 = -1, int io = -1);
 	static int read(int bits);
+	static int second() { return _second; }
+	static bool read_four_score(int *pads);
+	static bool read_multitap(int *pads);
+	static void read_chain(uint8_t *bytes, uint8_t count);
 
 };
 
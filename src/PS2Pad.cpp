@@ -25,6 +25,9 @@ byte PS2Pad::_pad_data[21];
 byte PS2Pad::_read_delay = 1;
 bool PS2Pad::_disableInt = false;
 bool PS2Pad::_analogMode = false;
+bool PS2Pad::_motors = false;
+byte PS2Pad::_motor_small = 0x00;
+byte PS2Pad::_motor_large = 0x00;
 
 byte PS2Pad::gamepad_spi(byte send_data) {
 	byte recv_data = 0;
@@ -56,7 +59,16 @@ byte PS2Pad::gamepad_spi(byte send_data) {
 	return recv_data;
 }
 
-void PS2Pad::send_command(byte data[], byte size) {
+// Length of a poll frame as announced by the mode byte: the low nibble is
+// the number of 16 bit data words following the 3 byte header, 0 meaning a
+// full 21 byte frame.
+static byte frame_length(byte mode) {
+	byte words = mode & 0x0F;
+
+	return words ? 3 + (words << 1) : 21;
+}
+
+void PS2Pad::send_command(byte data[], byte size, bool adaptive) {
 
 	if(PS2Pad::_disableInt)
 		noInterrupts();
@@ -70,6 +82,13 @@ void PS2Pad::send_command(byte data[], byte size) {
 
 	for(byte i = 0; i < size; i++) {
 		data[i] = PS2Pad::gamepad_spi(data[i]);
+
+		if(adaptive && i == 1) {
+			byte length = frame_length(data[1]);
+
+			if(length < size)
+				size = length;
+		}
 	}
 
 	digitalWriteFast(ATT_PIN, HIGH);
@@ -77,20 +96,30 @@ void PS2Pad::send_command(byte data[], byte size) {
 	if(PS2Pad::_disableInt)
 		interrupts();
 
-	delayMicroseconds(PS2Pad::_read_delay * 1000);
+	delayMicroseconds(PS2Pad::_read_delay * CTRL_FRAME_DELAY);
 }
 
 void PS2Pad::read() {
 	PS2Pad::_pad_data[0] = 0x01;
 	PS2Pad::_pad_data[1] = 0x42;
 
-	delayMicroseconds(PS2Pad::_read_delay * 1000);
+	delayMicroseconds(PS2Pad::_read_delay * CTRL_FRAME_DELAY);
 
 	for (byte i = 2; i < 21; i++) {
 		PS2Pad::_pad_data[i] = 0x00;
 	}
 
-	PS2Pad::send_command(PS2Pad::_pad_data, 21);
+	// Motor values go out in the two button bytes (see the 0x4D mapping)
+	PS2Pad::_pad_data[3] = PS2Pad::_motor_small;
+	PS2Pad::_pad_data[4] = PS2Pad::_motor_large;
+
+	PS2Pad::send_command(PS2Pad::_pad_data, 21, true);
+
+	// Bytes past the announced frame were never clocked; report them as the
+	// idle (pulled up) bus, same as a full length read would.
+	for (byte i = frame_length(PS2Pad::_pad_data[1]); i < 21; i++) {
+		PS2Pad::_pad_data[i] = 0xFF;
+	}
 }
 
 int PS2Pad::init(bool disableInt) {
@@ -129,17 +158,37 @@ int PS2Pad::init(bool disableInt) {
 
 		PS2Pad::_type = get_pad_type_command[3];
 
+		// Reply byte 6 counts the vibration motors, valid only if the pad
+		// answered in config mode (0xF3)
+		PS2Pad::_motors = get_pad_type_command[1] == 0xF3 && get_pad_type_command[6];
+
 		// Lock to Analog Mode on Stick
 		byte lock_analog_mode_command[] = {0x01, 0x44, 0x00, 0x01, 0x03, 0x00, 0x00, 0x00, 0x00};
 		PS2Pad::send_command(lock_analog_mode_command, 9);
 
+		// Map the small motor to poll byte 3 and the large motor to byte 4,
+		// only on pads that have motors
+		if(PS2Pad::_motors) {
+			byte map_motors_command[] = {0x01, 0x4D, 0x00, 0x00, 0x01, 0xFF, 0xFF, 0xFF, 0xFF};
+			PS2Pad::send_command(map_motors_command, 9);
+		}
+
+#ifdef PS2_PRESSURES
+		// Enable all 12 pressure bytes on DualShock 2 pads (mode 0x79), unless
+		// the frame gaps make the longer poll too slow (see PS2Pad.h)
+		if(PS2Pad::_type == 0x03 && PS2Pad::_read_delay <= PS2_PRESSURES_READ_DELAY) {
+			byte enable_pressures_command[] = {0x01, 0x4F, 0x00, 0xFF, 0xFF, 0x03, 0x00, 0x00, 0x00};
+			PS2Pad::send_command(enable_pressures_command, 9);
+		}
+#endif
+
 		// Exit config mode
 		byte exit_config_command[] = {0x01, 0x43, 0x00, 0x00, 0x5A, 0x5A, 0x5A, 0x5A, 0x5A};
 		PS2Pad::send_command(exit_config_command, 9);
 
 		PS2Pad::read();
 
-		if(PS2Pad::_pad_data[1] == 0x73) {
+		if(PS2Pad::_pad_data[1] == 0x73 || PS2Pad::_pad_data[1] == 0x79) {
 			_analogMode = true;
 			break;
 		}
@@ -164,6 +213,21 @@ byte PS2Pad::stick(word stick) {
 	return PS2Pad::_pad_data[stick];
 }
 
+bool PS2Pad::pressures() {
+	return PS2Pad::_pad_data[1] == 0x79;
+}
+
+byte PS2Pad::pressure(word button) {
+	return PS2Pad::_pad_data[button];
+}
+
+// The small motor is either off or on (0xFF), the large one takes a speed.
+// Speeds below 0x40 don't make it spin.
+void PS2Pad::rumble(byte small, byte large) {
+	PS2Pad::_motor_small = small ? 0xFF : 0x00;
+	PS2Pad::_motor_large = large;
+}
+
 byte PS2Pad::type() {
 	if((PS2Pad::_type == 0x03) || PS2Pad::_analogMode)
 		return 1;
@@ -172,3 +236,8 @@ byte PS2Pad::type() {
 
 	return 0;
 }
+
+// True between frames: attention high, so the pad ignores CMD and CLK
+bool PS2Pad::bus_idle() {
+	return BIT_READ(*digitalPinToPortReg(ATT_PIN), __digitalPinToBit(ATT_PIN));
+}
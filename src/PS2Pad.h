@@ -26,9 +26,36 @@
 #define ATT_PIN 7
 #define CMD_PIN 6
 
+// Uncomment to clock the pad at ~250kHz instead of ~25kHz and shorten the
+// gap between frames, bringing a full 21 byte poll under 1ms. The USART
+// master SPI mode can't be used instead: its XCK pin (PD4) is USB D-, and the
+// SPI module pins are taken by the arcade port.
+//#define PS2_FAST_SPI
+
+// A 21 byte poll with PS2_FAST_SPI takes ~0.94ms at _read_delay 1 and goes
+// over 1ms past it, each step adding 200us of frame gaps. Pads that needed a
+// longer delay in init() are left in the 9 byte 0x73 mode.
+#ifdef PS2_FAST_SPI
+#define CTRL_CLK 2
+#define CTRL_FRAME_DELAY 100
+#define PS2_PRESSURES_READ_DELAY 1
+#else
 #define CTRL_CLK 20
+#define CTRL_FRAME_DELAY 1000
+#define PS2_PRESSURES_READ_DELAY 0xFF
+#endif
 #define CTRL_BYTE_DELAY 3
 
+// Uncomment to switch DualShock 2 pads to pressure mode (0x79). Its 12 more
+// bytes a poll take ~4ms at the default clock, more than the whole 9 byte
+// 0x73 frame, so it comes with PS2_FAST_SPI only unless asked for. Only the
+// full PS3 report carries the pressure axes.
+//#define PS2_PRESSURES
+
+#ifdef PS2_FAST_SPI
+#define PS2_PRESSURES
+#endif
+
 //These are our button constants
 #define PSB_SELECT      0x0001
 #define PSB_L3          0x0002
@@ -53,24 +80,45 @@
 #define PSS_LX 7
 #define PSS_LY 8
 
+//These are pressure values, only valid in pressure mode (0x79)
+#define PSAB_PAD_RIGHT  9
+#define PSAB_PAD_LEFT   10
+#define PSAB_PAD_UP     11
+#define PSAB_PAD_DOWN   12
+#define PSAB_TRIANGLE   13
+#define PSAB_CIRCLE     14
+#define PSAB_CROSS      15
+#define PSAB_SQUARE     16
+#define PSAB_L1         17
+#define PSAB_R1         18
+#define PSAB_L2         19
+#define PSAB_R2         20
+
 class PS2Pad {
 
 private:
 	static byte gamepad_spi(byte send_data);
-	static void send_command(byte data[], byte size);
-	static word psx_buttons();
+	static void send_command(byte data[], byte size, bool adaptive = false);
 	static byte _type;
 	static byte _pad_data[21];
 	static byte _read_delay;
 	static bool _disableInt;
 	static bool _analogMode;
+	static bool _motors;
+	static byte _motor_small;
+	static byte _motor_large;
 
 public:
 	static int init(bool disableInt);
 	static void read();
 	static byte type();
 	static byte button(word button);
+	static word psx_buttons();
 	static byte stick(word analog);
+	static bool pressures();
+	static byte pressure(word button);
+	static void rumble(byte small, byte large);
+	static bool bus_idle();
 };
 
 
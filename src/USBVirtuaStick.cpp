@@ -17,12 +17,167 @@
  */
 
 #include "USBVirtuaStick.h"
+#include "ticks.h"
+#include "padmap.h"
+#include "turbo.h"
+#include "socd.h"
+#include "settings.h"
 
 /* ------------------------------------------------------------------------- */
 /* ----------------------------- USB interface ----------------------------- */
 /* ------------------------------------------------------------------------- */
 
-const PROGMEM char usbHidReportDescriptor[114] = { /* USB report descriptor, size must match usbconfig.h */
+const PROGMEM char usbHidReportDescriptor[USB_CFG_HID_REPORT_DESCRIPTOR_LENGTH] = { /* USB report descriptor, size must match usbconfig.h */
+#if USB_CFG_PLAYERS > 1
+		0x05, 0x01, // USAGE_PAGE (Generic Desktop)
+		0x09, 0x05, // USAGE (Gamepad)
+		0xa1, 0x01, // COLLECTION (Application)
+		0x85, 0x01, //   REPORT_ID (1)
+		0x15, 0x00, //   LOGICAL_MINIMUM (0)
+		0x25, 0x01, //   LOGICAL_MAXIMUM (1)
+		0x35, 0x00, //   PHYSICAL_MINIMUM (0)
+		0x45, 0x01, //   PHYSICAL_MAXIMUM (1)
+		0x75, 0x01, //   REPORT_SIZE (1)
+		0x95, 0x0d, //   REPORT_COUNT (13)
+		0x05, 0x09, //   USAGE_PAGE (Button)
+		0x19, 0x01, //   USAGE_MINIMUM (Button 1)
+		0x29, 0x0d, //   USAGE_MAXIMUM (Button 13)
+		0x81, 0x02, //   INPUT (Data,Var,Abs)
+		0x95, 0x03, //   REPORT_COUNT (3)
+		0x81, 0x01, //   INPUT (Cnst,Ary,Abs)
+		0x05, 0x01, //   USAGE_PAGE (Generic Desktop)
+		0x25, 0x07, //   LOGICAL_MAXIMUM (7)
+		0x46, 0x3b, 0x01, //   PHYSICAL_MAXIMUM (315)
+		0x75, 0x04, //   REPORT_SIZE (4)
+		0x95, 0x01, //   REPORT_COUNT (1)
+		0x65, 0x14, //   UNIT (Eng Rot:Angular Pos)
+		0x09, 0x39, //   USAGE (Hat switch)
+		0x81, 0x42, //   INPUT (Data,Var,Abs,Null)
+		0x65, 0x00, //   UNIT (None)
+		0x95, 0x01, //   REPORT_COUNT (1)
+		0x81, 0x01, //   INPUT (Cnst,Ary,Abs)
+		0x26, 0xff, 0x00, //   LOGICAL_MAXIMUM (255)
+		0x46, 0xff, 0x00, //   PHYSICAL_MAXIMUM (255)
+		0x09, 0x30, //   USAGE (X)
+		0x09, 0x31, //   USAGE (Y)
+		0x09, 0x32, //   USAGE (Z)
+		0x09, 0x35, //   USAGE (Rz)
+		0x09, 0x36,	//	 USAGE (Slider)
+		0x75, 0x08, //   REPORT_SIZE (8)
+		0x95, 0x05, //   REPORT_COUNT (5)
+		0x81, 0x02, //   INPUT (Data,Var,Abs)
+		// Rumble output report, the sixaxis layout after the report ID:
+		// padding, small motor duration and on/off, large motor duration and
+		// force (see usbFunctionWrite())
+		0x06, 0x00, 0xff, //   USAGE_PAGE (Vendor Defined Page 1)
+		0x19, 0x01, //   USAGE_MINIMUM (Vendor Usage 1)
+		0x29, 0x05, //   USAGE_MAXIMUM (Vendor Usage 5)
+		0x91, 0x02, //   OUTPUT (Data,Var,Abs)
+#if USB_CFG_EXTRA_BUTTONS
+		0x05, 0x09, //   USAGE_PAGE (Button)
+		0x19, 0x0e, //   USAGE_MINIMUM (Button 14)
+		0x29, 0x0d + USB_CFG_EXTRA_BUTTONS, //   USAGE_MAXIMUM (Button 13 + extra)
+		0x25, 0x01, //   LOGICAL_MAXIMUM (1)
+		0x45, 0x01, //   PHYSICAL_MAXIMUM (1)
+		0x75, 0x01, //   REPORT_SIZE (1)
+		0x95, USB_CFG_EXTRA_BUTTONS, //   REPORT_COUNT (extra)
+		0x81, 0x02, //   INPUT (Data,Var,Abs)
+#endif
+		0xc0, // END_COLLECTION
+		// Players 2 to 4: buttons, hat switch, X and Y only. Logical and
+		// physical minimum stay 0 from player 1.
+		0x05, 0x01, // USAGE_PAGE (Generic Desktop)
+		0x09, 0x05, // USAGE (Gamepad)
+		0xa1, 0x01, // COLLECTION (Application)
+		0x85, 0x02, //   REPORT_ID (2)
+		0x25, 0x01, //   LOGICAL_MAXIMUM (1)
+		0x45, 0x00, //   PHYSICAL_MAXIMUM (0), same as logical
+		0x75, 0x01, //   REPORT_SIZE (1)
+		0x95, 0x10, //   REPORT_COUNT (16)
+		0x05, 0x09, //   USAGE_PAGE (Button)
+		0x19, 0x01, //   USAGE_MINIMUM (Button 1)
+		0x29, 0x10, //   USAGE_MAXIMUM (Button 16)
+		0x81, 0x02, //   INPUT (Data,Var,Abs)
+		0x05, 0x01, //   USAGE_PAGE (Generic Desktop)
+		0x25, 0x07, //   LOGICAL_MAXIMUM (7)
+		0x75, 0x08, //   REPORT_SIZE (8)
+		0x95, 0x01, //   REPORT_COUNT (1)
+		0x09, 0x39, //   USAGE (Hat switch)
+		0x81, 0x42, //   INPUT (Data,Var,Abs,Null)
+		0x26, 0xff, 0x00, //   LOGICAL_MAXIMUM (255)
+		0x09, 0x30, //   USAGE (X)
+		0x09, 0x31, //   USAGE (Y)
+		0x95, 0x02, //   REPORT_COUNT (2)
+		0x81, 0x02, //   INPUT (Data,Var,Abs)
+		0xc0, // END_COLLECTION
+#if USB_CFG_PLAYERS > 2
+		// Players 3 and 4 keep the global items player 2 left: usage page,
+		// logical and physical minimum and physical maximum
+		0x09, 0x05, // USAGE (Gamepad)
+		0xa1, 0x01, // COLLECTION (Application)
+		0x85, 0x03, //   REPORT_ID (3)
+		0x25, 0x01, //   LOGICAL_MAXIMUM (1)
+		0x75, 0x01, //   REPORT_SIZE (1)
+		0x95, 0x10, //   REPORT_COUNT (16)
+		0x05, 0x09, //   USAGE_PAGE (Button)
+		0x19, 0x01, //   USAGE_MINIMUM (Button 1)
+		0x29, 0x10, //   USAGE_MAXIMUM (Button 16)
+		0x81, 0x02, //   INPUT (Data,Var,Abs)
+		0x05, 0x01, //   USAGE_PAGE (Generic Desktop)
+		0x25, 0x07, //   LOGICAL_MAXIMUM (7)
+		0x75, 0x08, //   REPORT_SIZE (8)
+		0x95, 0x01, //   REPORT_COUNT (1)
+		0x09, 0x39, //   USAGE (Hat switch)
+		0x81, 0x42, //   INPUT (Data,Var,Abs,Null)
+		0x26, 0xff, 0x00, //   LOGICAL_MAXIMUM (255)
+		0x09, 0x30, //   USAGE (X)
+		0x09, 0x31, //   USAGE (Y)
+		0x95, 0x02, //   REPORT_COUNT (2)
+		0x81, 0x02, //   INPUT (Data,Var,Abs)
+		0xc0, // END_COLLECTION
+		0x09, 0x05, // USAGE (Gamepad)
+		0xa1, 0x01, // COLLECTION (Application)
+		0x85, 0x04, //   REPORT_ID (4)
+		0x25, 0x01, //   LOGICAL_MAXIMUM (1)
+		0x75, 0x01, //   REPORT_SIZE (1)
+		0x95, 0x10, //   REPORT_COUNT (16)
+		0x05, 0x09, //   USAGE_PAGE (Button)
+		0x19, 0x01, //   USAGE_MINIMUM (Button 1)
+		0x29, 0x10, //   USAGE_MAXIMUM (Button 16)
+		0x81, 0x02, //   INPUT (Data,Var,Abs)
+		0x05, 0x01, //   USAGE_PAGE (Generic Desktop)
+		0x25, 0x07, //   LOGICAL_MAXIMUM (7)
+		0x75, 0x08, //   REPORT_SIZE (8)
+		0x95, 0x01, //   REPORT_COUNT (1)
+		0x09, 0x39, //   USAGE (Hat switch)
+		0x81, 0x42, //   INPUT (Data,Var,Abs,Null)
+		0x26, 0xff, 0x00, //   LOGICAL_MAXIMUM (255)
+		0x09, 0x30, //   USAGE (X)
+		0x09, 0x31, //   USAGE (Y)
+		0x95, 0x02, //   REPORT_COUNT (2)
+		0x81, 0x02, //   INPUT (Data,Var,Abs)
+		0xc0, // END_COLLECTION
+#endif
+#if USB_CFG_SETTINGS_DESCRIPTOR_LENGTH
+		// Settings feature reports: pad and 16 bytes after the report ID.
+		// Logical minimum and maximum (0 and 255) and the report size (8)
+		// stay from the last player.
+		0x06, 0x00, 0xff, // USAGE_PAGE (Vendor Defined Page 1)
+		0x09, 0x01, // USAGE (Vendor Usage 1)
+		0xa1, 0x01, // COLLECTION (Application)
+		0x95, VS_SETTINGS_REPORT_SIZE - 1, //   REPORT_COUNT (17)
+		0x85, VS_REMAP_REPORT, //   REPORT_ID (VS_REMAP_REPORT)
+		0x09, VS_REMAP_REPORT, //   USAGE (Vendor Usage 0x10)
+		0xb1, 0x02, //   FEATURE (Data,Var,Abs)
+		0x85, VS_TURBO_REPORT, //   REPORT_ID (VS_TURBO_REPORT)
+		0x09, VS_TURBO_REPORT, //   USAGE (Vendor Usage 0x11)
+		0xb1, 0x02, //   FEATURE (Data,Var,Abs)
+		0x85, VS_SOCD_REPORT, //   REPORT_ID (VS_SOCD_REPORT)
+		0x09, VS_SOCD_REPORT, //   USAGE (Vendor Usage 0x12)
+		0xb1, 0x02, //   FEATURE (Data,Var,Abs)
+		0xc0, // END_COLLECTION
+#endif
+#else
 0x05, 0x01, // USAGE_PAGE (Generic Desktop)
 		0x09, 0x05, // USAGE (Gamepad)
 		0xa1, 0x01, // COLLECTION (Application)
@@ -59,6 +214,29 @@ const PROGMEM char usbHidReportDescriptor[114] = { /* USB report descriptor, siz
 		0x75, 0x08, //   REPORT_SIZE (8)
 		0x95, 0x05, //   REPORT_COUNT (5)
 		0x81, 0x02, //   INPUT (Data,Var,Abs)
+#if USB_CFG_COMPACT_REPORT
+		// Rumble output report in the sixaxis layout, its first byte standing
+		// in for the report ID: padding, small motor duration and on/off,
+		// large motor duration and force (see usbFunctionWrite())
+		0x06, 0x00, 0xff, //   USAGE_PAGE (Vendor Defined Page 1)
+		0x95, 0x01, //   REPORT_COUNT (1)
+		0x91, 0x01, //   OUTPUT (Cnst,Ary,Abs)
+		0x19, 0x01, //   USAGE_MINIMUM (Vendor Usage 1)
+		0x29, 0x05, //   USAGE_MAXIMUM (Vendor Usage 5)
+		0x95, 0x05, //   REPORT_COUNT (5)
+		0x91, 0x02, //   OUTPUT (Data,Var,Abs)
+#endif
+#if USB_CFG_EXTRA_BUTTONS
+		0x05, 0x09, //   USAGE_PAGE (Button)
+		0x19, 0x0e, //   USAGE_MINIMUM (Button 14)
+		0x29, 0x0d + USB_CFG_EXTRA_BUTTONS, //   USAGE_MAXIMUM (Button 13 + extra)
+		0x25, 0x01, //   LOGICAL_MAXIMUM (1)
+		0x45, 0x01, //   PHYSICAL_MAXIMUM (1)
+		0x75, 0x01, //   REPORT_SIZE (1)
+		0x95, USB_CFG_EXTRA_BUTTONS, //   REPORT_COUNT (extra)
+		0x81, 0x02, //   INPUT (Data,Var,Abs)
+#endif
+#if !USB_CFG_COMPACT_REPORT
 		0x06, 0x00, 0xff, //   USAGE_PAGE (Vendor Specific)
 		0x09, 0x20, //   Unknown
 		0x09, 0x21, //   Unknown
@@ -77,24 +255,113 @@ const PROGMEM char usbHidReportDescriptor[114] = { /* USB report descriptor, siz
 		0x0a, 0x21, 0x26, //   Unknown
 		0x95, 0x08, //   REPORT_COUNT (8)
 		0xb1, 0x02, //   FEATURE (Data,Var,Abs)
+#endif
 		0xc0, // END_COLLECTION
+#endif
 		};
 
 /* ------------------------------------------------------------------------- */
 
 gamepad_state_t gamepad_state;
+#if VS_PLAYERS > 1
+static gamepad_state_t player_states[VS_PLAYERS - 1];
+#endif
 static uchar ps3_magic_bytes[8] = { 0x21, 0x26, 0x01, 0x07, 0x00, 0x00, 0x00,
 		0x00 };
 static uchar idleRate;
 
+// Snapshot of the report being sent to the host. It is taken from
+// gamepad_state only when the interrupt endpoint is free, so the host
+// always gets the freshest sample and all packets of a report come from
+// the same snapshot. It also serves as the shadow copy used to suppress
+// reports that didn't change until the host's idle period runs out.
+// Each player has its own snapshot; force_report has one bit per player.
+static gamepad_state_t last_state[VS_PLAYERS];
+static uchar tx_offset;
+static uint16_t last_report_ticks[VS_PLAYERS];
+static uchar idle_elapsed[VS_PLAYERS];
+static uchar force_report = VS_ALL_PLAYERS;
+
+#if VS_PLAYERS > 1
+// Report ID followed by the snapshot of the player being sent
+static uchar tx_report[1 + VS_REPORT_SIZE];
+static uchar tx_size;
+static uchar tx_player;
+#else
+static const uchar tx_size = VS_REPORT_SIZE;
+#endif
+
+// Report being received through usbFunctionWrite(): an output report
+// (rumble) or a settings feature report. Only the first bytes are kept, the
+// rest of a longer report is ignored.
+static uchar write_report[VS_SETTINGS_REPORT_SIZE];
+static uchar write_type;
+static uchar write_pos;
+static uchar write_left;
+
+// Rumble from HID output reports, in the sixaxis layout: report id, padding,
+// right (small) motor duration and on/off, left (large) motor duration and
+// force.
+static uchar rumble_small;
+static uchar rumble_large;
+static bool rumble_changed;
+
+static void reset_state(gamepad_state_t *state) {
+	memset(state, 0x00, sizeof(gamepad_state_t));
+	state->direction = 0x08;
+	state->l_x_axis = 0x80;
+	state->l_y_axis = 0x80;
+	state->r_x_axis = 0x80;
+	state->r_y_axis = 0x80;
+	state->slider = 0x80;
+}
+
 void vs_reset_pad_status() {
-	memset(&gamepad_state, 0x00, sizeof(gamepad_state_t));
-	gamepad_state.direction = 0x08;
-	gamepad_state.l_x_axis = 0x80;
-	gamepad_state.l_y_axis = 0x80;
-	gamepad_state.r_x_axis = 0x80;
-	gamepad_state.r_y_axis = 0x80;
-	gamepad_state.slider = 0x80;
+	for(uchar i = 0; i < VS_PLAYERS; i++)
+		reset_state(vs_player_state(i));
+}
+
+gamepad_state_t *vs_player_state(uint8_t player) {
+#if VS_PLAYERS > 1
+	if(player)
+		return &player_states[player - 1];
+#endif
+	return &gamepad_state;
+}
+
+// Report bytes of each player, after the report ID
+static uchar report_size(uchar player) {
+	return player ? VS_PLAYER_REPORT_SIZE : VS_REPORT_SIZE;
+}
+
+// Takes a snapshot of player's state if a report has to go out for it
+static bool take_report(uchar player) {
+	gamepad_state_t *state = vs_player_state(player);
+
+	// Nothing changed since the last report: skip it, unless the host asked
+	// for periodic reports (SET_IDLE) and the idle period has run out.
+	// The period is counted in the host's 4ms units: up to 1020ms doesn't
+	// fit in ticks, which wrap after ~1s at 16Mhz and sooner above.
+	if(!(force_report & (1 << player)) && !memcmp(&last_state[player], state, report_size(player))) {
+		if(!idleRate)
+			return false;
+
+		while(idle_elapsed[player] < idleRate &&
+				(uint16_t)(ticks_now() - last_report_ticks[player]) >= TICKS_US(4000)) {
+			last_report_ticks[player] += TICKS_US(4000);
+			idle_elapsed[player]++;
+		}
+
+		if(idle_elapsed[player] < idleRate)
+			return false;
+	}
+
+	memcpy(&last_state[player], state, report_size(player));
+	last_report_ticks[player] = ticks_now();
+	idle_elapsed[player] = 0;
+	force_report &= ~(1 << player);
+
+	return true;
 }
 
 void vs_init(bool watchdog) {
@@ -112,6 +379,8 @@ void vs_init(bool watchdog) {
 
 	vs_reset_pad_status();
 
+	ticks_init();
+
 	if(watchdog) {
 		wdt_enable(WDTO_2S);
 	} else {
@@ -141,15 +410,103 @@ void vs_reset_watchdog() {
 }
 
 void vs_send_pad_state() {
-	while (!usbInterruptIsReady())
-		usbPoll();
-	usbSetInterrupt((unsigned char *) &gamepad_state, 8);
-	while (!usbInterruptIsReady())
+	uchar len;
+
+	usbPoll();
+	settings_task();
+
+	// Never wait for the host here: if it hasn't fetched the previous packet
+	// yet, return and let the caller sample the pad again.
+	if(!usbInterruptIsReady())
+		return;
+
+	if(tx_offset == 0) {
+#if VS_PLAYERS > 1
+		uchar i;
+
+		// Players take turns, so one pad can't hold the others' reports off
+		for(i = 0; i < VS_PLAYERS; i++) {
+			if(++tx_player == VS_PLAYERS)
+				tx_player = 0;
+
+			if(take_report(tx_player))
+				break;
+		}
+
+		if(i == VS_PLAYERS)
+			return;
+
+		tx_size = 1 + report_size(tx_player);
+		tx_report[0] = tx_player + 1;
+		memcpy(tx_report + 1, &last_state[tx_player], tx_size - 1);
+#else
+		if(!take_report(0))
+			return;
+#endif
+	}
+
+	// Reports larger than 8 bytes go out in several low speed packets
+	len = tx_size - tx_offset;
+	if(len > 8)
+		len = 8;
+
+#if VS_PLAYERS > 1
+	usbSetInterrupt(tx_report + tx_offset, len);
+#else
+	usbSetInterrupt((unsigned char *) &last_state[0] + tx_offset, len);
+#endif
+
+	tx_offset += len;
+	if(tx_offset >= tx_size)
+		tx_offset = 0;
+}
+
+// Waits for the host to fetch the packet vs_send_pad_state() queued last, if
+// there is one. The interrupt endpoint then stays quiet until the next poll
+// (USB_CFG_INTR_POLL_INTERVAL ms), which leaves room for a pad transaction
+// with interrupts off. Control transfers on endpoint 0 (rumble, settings
+// reports, GET_REPORT) don't follow that schedule: V-USB misses a packet of
+// one that comes during the transaction and the host sends it again. With
+// nothing queued (the report didn't change and the idle period hasn't run
+// out) it returns at once; a poll missed then had no data to carry, and the
+// host retries it on the next interval. Gives up after a bit more than one
+// poll interval in case the host isn't polling yet (or at all).
+void vs_wait_poll() {
+	uint16_t start = ticks_now();
+
+	while(!usbInterruptIsReady()) {
 		usbPoll();
-	usbSetInterrupt((unsigned char *) &gamepad_state + 8, 8);
-	while (!usbInterruptIsReady())
+
+		if((uint16_t)(ticks_now() - start) >= TICKS_US(USB_CFG_INTR_POLL_INTERVAL * 1200UL))
+			break;
+	}
+}
+
+// Waits until the last report has gone out whole, sending the rest of its
+// packets, and makes the next vs_send_pad_state() take player 1's state even
+// if it didn't change. A pass of the pad loop between two calls is then one
+// complete report, which is what macro recording and playback count as a
+// frame: with the full PS3 report one packet per pass would let a short
+// step fall between two reports. Gives up like vs_wait_poll() if the host
+// stops fetching.
+void vs_wait_report() {
+	uint16_t start = ticks_now();
+
+	for(;;) {
 		usbPoll();
-	usbSetInterrupt((unsigned char *) &gamepad_state + 16, 4);
+
+		if(usbInterruptIsReady()) {
+			if(!tx_offset)
+				break;
+
+			vs_send_pad_state();
+			start = ticks_now();
+		} else if((uint16_t)(ticks_now() - start) >= TICKS_US(USB_CFG_INTR_POLL_INTERVAL * 1200UL)) {
+			break;
+		}
+	}
+
+	force_report |= 1;
 }
 
 usbMsgLen_t usbFunctionSetup(uchar data[8]) {
@@ -163,6 +520,22 @@ usbMsgLen_t usbFunctionSetup(uchar data[8]) {
 				if (rq->wValue.bytes[0] == 0) {
 					usbMsgPtr = (uchar *) ps3_magic_bytes;
 					return sizeof(ps3_magic_bytes);
+				} else if (rq->wValue.bytes[0] >= VS_REMAP_REPORT && rq->wValue.bytes[0] <= VS_SOCD_REPORT) {
+					// Settings of the pad in use
+					write_report[0] = rq->wValue.bytes[0];
+					write_report[1] = padmap_current();
+
+					if (write_report[0] == VS_REMAP_REPORT) {
+						padmap_read(write_report[1], write_report + 2);
+					} else if (write_report[0] == VS_TURBO_REPORT) {
+						turbo_read(write_report[1], write_report + 2);
+					} else {
+						memset(write_report + 2, 0, VS_SETTINGS_REPORT_SIZE - 2);
+						write_report[2] = socd_read(write_report[1]);
+					}
+
+					usbMsgPtr = write_report;
+					return VS_SETTINGS_REPORT_SIZE;
 				}
 			}
 
@@ -171,6 +544,17 @@ usbMsgLen_t usbFunctionSetup(uchar data[8]) {
 			return 1;
 		} else if (rq->bRequest == USBRQ_HID_SET_IDLE) {
 			idleRate = rq->wValue.bytes[1];
+			// idleRate is in 4ms units, 0 means report on change only
+			force_report = VS_ALL_PLAYERS;
+		} else if (rq->bRequest == USBRQ_HID_SET_REPORT) {
+			// #define HID_REPORT_TYPE_OUTPUT 2
+			if (rq->wValue.bytes[1] == 0x02 || (rq->wValue.bytes[1] == 0x03 &&
+					rq->wValue.bytes[0] >= VS_REMAP_REPORT && rq->wValue.bytes[0] <= VS_SOCD_REPORT)) {
+				write_type = rq->wValue.bytes[1];
+				write_pos = 0;
+				write_left = rq->wLength.bytes[1] ? 0xFF : rq->wLength.bytes[0];
+				return USB_NO_MSG; /* data arrives through usbFunctionWrite() */
+			}
 		}
 
 	} else {
@@ -179,3 +563,53 @@ usbMsgLen_t usbFunctionSetup(uchar data[8]) {
 
 	return 0; /* default for not implemented requests: return no data back to host */
 }
+
+uchar usbFunctionWrite(uchar *data, uchar len) {
+	for(uchar i = 0; i < len; i++) {
+		if(write_pos < sizeof(write_report))
+			write_report[write_pos++] = data[i];
+	}
+
+	if(len < write_left) {
+		write_left -= len;
+		return 0;
+	}
+
+	/* last chunk of the report */
+	write_left = 0;
+
+	if(write_type == 0x02) {
+		rumble_small = write_report[3];
+		rumble_large = write_report[5];
+		rumble_changed = true;
+	} else if(write_pos == VS_SETTINGS_REPORT_SIZE && write_report[1] < PADMAP_PADS) {
+		bool queued;
+
+		// Stores only queue the EEPROM write, settings_task() does it later
+		if(write_report[0] == VS_REMAP_REPORT)
+			queued = padmap_store(write_report[1], write_report + 2);
+		else if(write_report[0] == VS_TURBO_REPORT)
+			queued = turbo_store(write_report[1], write_report + 2);
+		else
+			queued = socd_store(write_report[1], write_report[2]);
+
+		if(!queued)
+			return 0xff; /* STALL: the last one isn't in EEPROM yet */
+	}
+
+	return 1;
+}
+
+// Returns true and the latest motor values if the host sent a new output
+// report since the last call.
+bool vs_get_rumble(uint8_t *small, uint8_t *large) {
+	if(!rumble_changed)
+		return false;
+
+	rumble_changed = false;
+
+	*small = rumble_small;
+	*large = rumble_large;
+
+	return true;
+}
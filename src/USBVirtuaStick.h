@@ -24,6 +24,7 @@
 #include <avr/interrupt.h>  /* for sei() */
 #include <util/delay.h>     /* for _delay_ms() */
 #include <string.h>			/* for memset() */
+#include <stddef.h>			/* for offsetof() */
 
 #include <avr/pgmspace.h>   /* required by usbdrv.h */
 
@@ -80,11 +81,71 @@ typedef struct {
 	uint8_t r2_axis;
 } gamepad_state_t;
 
+// Bytes of gamepad_state_t sent to the host on each report. The compact
+// report is just the first 8 bytes (buttons, hat, sticks and slider), then
+// the extra buttons (USB_CFG_EXTRA_BUTTONS) in the bytes the PS3 layout
+// leaves unknown.
+#if USB_CFG_COMPACT_REPORT
+#define VS_REPORT_SIZE (8 + USB_CFG_EXTRA_BUTTONS / 8)
+#else
+#define VS_REPORT_SIZE sizeof(gamepad_state_t)
+#endif
+
+// Report byte and bit of each button, for padmap_t tables (see padmap.h)
+#define VS_SQUARE			0, 0x01
+#define VS_CROSS			0, 0x02
+#define VS_CIRCLE			0, 0x04
+#define VS_TRIANGLE			0, 0x08
+#define VS_L1				0, 0x10
+#define VS_R1				0, 0x20
+#define VS_L2				0, 0x40
+#define VS_R2				0, 0x80
+#define VS_SELECT			1, 0x01
+#define VS_START			1, 0x02
+#define VS_L3				1, 0x04
+#define VS_R3				1, 0x08
+#define VS_PS				1, 0x10
+#define VS_TRIANGLE_AXIS	offsetof(gamepad_state_t, triangle_axis), 0xFF
+#define VS_CIRCLE_AXIS		offsetof(gamepad_state_t, circle_axis), 0xFF
+#define VS_CROSS_AXIS		offsetof(gamepad_state_t, cross_axis), 0xFF
+#define VS_SQUARE_AXIS		offsetof(gamepad_state_t, square_axis), 0xFF
+#define VS_L1_AXIS			offsetof(gamepad_state_t, l1_axis), 0xFF
+#define VS_R1_AXIS			offsetof(gamepad_state_t, r1_axis), 0xFF
+#define VS_L2_AXIS			offsetof(gamepad_state_t, l2_axis), 0xFF
+#define VS_R2_AXIS			offsetof(gamepad_state_t, r2_axis), 0xFF
+
+// First byte of the extra buttons, one bit each, button 14 in bit 0
+#define VS_EXTRA_BUTTONS	offsetof(gamepad_state_t, unknown)
+
+// Feature reports used to read and change the per pad settings:
+// { report id, pad (PADMAP_*), one byte for each of the 16 raw button bits }.
+// Reading one returns the settings of the pad in use; writing one queues the
+// settings of the given pad for EEPROM (see settings_write()), and stalls if
+// the last write of the same report isn't in yet. See usbconfig.h for which
+// builds declare them in the report descriptor.
+#define VS_REMAP_REPORT			0x10	// source raw bit of each bit
+#define VS_TURBO_REPORT			0x11	// turbo rate in Hz, 0 = off
+#define VS_SOCD_REPORT			0x12	// SOCD_* mode in the first byte, rest unused
+#define VS_SETTINGS_REPORT_SIZE	18
+
 void vs_reset_pad_status();
 void vs_init(bool watchdog);
 void vs_reset_watchdog();
 void vs_send_pad_state();
+void vs_wait_poll();
+void vs_wait_report();
+bool vs_get_rumble(uint8_t *small, uint8_t *large);
 
 extern gamepad_state_t gamepad_state;
 
+// Players reported to the host (see USB_CFG_PLAYERS). gamepad_state is
+// player 1, vs_player_state() gives any player's state.
+#define VS_PLAYERS USB_CFG_PLAYERS
+#define VS_ALL_PLAYERS ((1 << VS_PLAYERS) - 1)
+
+// Bytes of the reports of players 2 to 4: buttons, hat, X and Y
+#define VS_PLAYER_REPORT_SIZE 5
+
+gamepad_state_t *vs_player_state(uint8_t player);
+
 #endif /* USBVIRTUASTICK_H_ */
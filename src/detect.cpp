@@ -0,0 +1,164 @@
+/*
+* USB RetroPad Adapter - PC/PS3 USB adapter for retro-controllers!
+* Copyright (c) 2012 Bruno Freitas - bruno@brunofreitas.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+#include "detect.h"
+#include "ticks.h"
+
+// Detection pins: DETPIN0 is PD6, DETPIN1-4 are PB0-PB3, ARCADE_DB9_PIN is PB4
+#define DETECT_PORTB	(_BV(PB0) | _BV(PB1) | _BV(PB2) | _BV(PB3) | _BV(PB4))
+#define DETECT_PORTD	_BV(PD6)
+
+// Pad lines used by the drivers: PD5-PD7 and PB0-PB5 (pins 5-13)
+#define PAD_LINES_PORTB	(DETECT_PORTB | _BV(PB5))
+#define PAD_LINES_PORTD	(_BV(PD5) | _BV(PD6) | _BV(PD7))
+
+// Time for the pull-ups to charge an open line, and for a pad to answer
+// DB9P7 (Genesis select) going high
+#define DETECT_SETTLE_US	10
+
+static int detect_pad;
+static int detect_next;
+static uint8_t detect_count;
+static uint16_t detect_last;
+
+static int detect_decode(uint8_t pinb, uint8_t pind) {
+	int pad;
+
+	// Check switch for Arcade position
+	if(pinb & _BV(PB4))
+		return PAD_ARCADE;
+
+	pad = (!(pind & _BV(PD6)) << 4) | (!(pinb & _BV(PB0)) << 3) | (!!(pinb & _BV(PB1)) << 2) |
+			(!!(pinb & _BV(PB2)) << 1) | !!(pinb & _BV(PB3));
+
+	if((pad >> 3) & 0b11) {
+		switch(pad) {
+		case 0b11011:
+		case 0b10111:
+			return PAD_TG16;
+			break;
+		case 0b11111:
+		case 0b01111:
+			return PAD_SATURN;
+			break;
+		case 0b11100:
+			return PAD_PS2;
+			break;
+		default:
+			return PAD_GENESIS;
+			break;
+		}
+	}
+
+	return (pad & 0b111);
+}
+
+// Reads the detection pins as pulled up inputs, leaving the driver's setup
+// of every pin as it was. V-USB's interrupt changes other PORTD and DDRD
+// bits, so PD6 is only touched with single bit instructions.
+static int detect_sample() {
+	uint8_t ddrb = DDRB, portb = PORTB;
+	bool ddrd = DDRD & DETECT_PORTD, portd = PORTD & DETECT_PORTD;
+	uint8_t pinb, pind;
+
+	DDRB = ddrb & ~DETECT_PORTB;
+	PORTB = portb | DETECT_PORTB;
+	DDRD &= ~DETECT_PORTD;
+	PORTD |= DETECT_PORTD;
+
+	_delay_us(DETECT_SETTLE_US);
+
+	pinb = PINB;
+	pind = PIND;
+
+	// Output levels first, so restored outputs don't glitch
+	PORTB = portb;
+	DDRB = ddrb;
+
+	if(!portd)
+		PORTD &= ~DETECT_PORTD;
+	if(ddrd)
+		DDRD |= DETECT_PORTD;
+
+	return detect_decode(pinb, pind);
+}
+
+/*
+ * This is the new auto-detect function (non jumper based) which detects the extension
+ * cable plugged in the DB9 port. It uses grounded pins from DB9 (4, 6, 7 and 9) for
+ * the detection.
+ *
+ *  -1 - Arcade
+ * 00111 - Sega Genesis (Default)
+ * 00110 - NES
+ * 00101 - SNES
+ * 00100 - PS2
+ * 00011 - Game Cube
+ * 00010 - Nintendo 64
+ * 00001 - Neo Geo
+ * 00000 - Reserved 1
+ * 01111 - Sega Saturn
+ * 10111 - TurboGrafx 16
+ */
+int detectPad() {
+	uint8_t sreg = SREG;
+
+	// Release the lines the previous driver may have left as outputs, then
+	// turn pull-ups on for the pad/arcade detection pins
+	cli();
+	DDRB &= ~PAD_LINES_PORTB;
+	PORTB = (PORTB & ~PAD_LINES_PORTB) | DETECT_PORTB;
+	DDRD &= ~PAD_LINES_PORTD;
+	PORTD = (PORTD & ~PAD_LINES_PORTD) | DETECT_PORTD;
+	SREG = sreg;
+
+	_delay_us(DETECT_SETTLE_US);
+
+	detect_pad = detect_decode(PINB, PIND);
+	detect_next = detect_pad;
+	detect_count = 0;
+	detect_last = ticks_now();
+
+	return detect_pad;
+}
+
+bool detect_changed(bool idle) {
+	int pad;
+
+	if(!idle || (uint16_t) (ticks_now() - detect_last) < TICKS_US(DETECT_INTERVAL_US))
+		return false;
+
+	detect_last = ticks_now();
+
+	pad = detect_sample();
+
+	if(pad == detect_pad) {
+		detect_count = 0;
+		return false;
+	}
+
+	if(pad != detect_next) {
+		detect_next = pad;
+		detect_count = 0;
+	}
+
+	return ++detect_count >= DETECT_CONFIRM;
+}
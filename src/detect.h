@@ -0,0 +1,86 @@
+/*
+* USB RetroPad Adapter - PC/PS3 USB adapter for retro-controllers!
+* Copyright (c) 2012 Bruno Freitas - bruno@brunofreitas.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DETECT_H_
+#define DETECT_H_
+
+#include <stdint.h>
+
+// Arcade mode detection pin
+#define ARCADE_DB9_PIN	12
+
+// Extension cable detection pins
+#define DETPIN0 6  // DB9P2
+#define DETPIN1	8  // DB9P4
+#define DETPIN2	9  // DB9P6
+#define DETPIN3	10 // DB9P7
+#define DETPIN4	11 // DB9P9
+
+// Possible values (as of today) returned by the detectPad() routine
+// Normal pads
+#define PAD_ARCADE		-1
+#define PAD_GENESIS		0b00111
+#define PAD_NES 		0b00110
+#define PAD_SNES 		0b00101
+#define PAD_PS2 		0b00100
+#define PAD_GC	 		0b00011
+#define PAD_N64			0b00010
+#define PAD_NEOGEO		0b00001
+#define PAD_WIICC		0b00000
+// Extended pads (uses DB9 pin 4 and/or 2 for identification)
+#define PAD_SATURN		0b01111
+#define PAD_TG16		0b10111
+#define PAD_DFU_DONGLE	0b01110 // Reserved for USBRA DFU dongle
+
+/*
+ * Hot-plug detection.
+ *
+ * detectPad() releases all pad lines and reads the cable in use. Pad loops
+ * then call detect_changed() once per frame, after the report went out.
+ * Every DETECT_INTERVAL it snapshots PINB and PIND with the detection pins
+ * briefly turned into pulled up inputs (restoring the driver's DDR and PORT
+ * bits right after) and decodes the snapshot like detectPad(). A different
+ * cable must read the same DETECT_CONFIRM times in a row. The loop then
+ * returns so loop() can start the new driver; the USB connection is kept.
+ *
+ * Several detection pins double as pad lines, so loops only pass 'idle'
+ * when sampling can't disturb or misread the pad:
+ *  - nothing held: no buttons, sticks within DETECT_STICK_SLACK of center
+ *    (see detect_stick_idle()), or the pad not answering at all
+ *  - no transfer in progress, and driver outputs on detection pins at
+ *    their idle high level, where the pull-ups keep them (Genesis select
+ *    high and its 6-button counter reset, PS2 attention high, TG16 select
+ *    and /OE high, Saturn S1 high)
+ * The NES/SNES latch and arcade clock idle low; the pulse the pull-up gives
+ * them is harmless, as every read starts with a new latch.
+ */
+#define DETECT_INTERVAL_US	100000UL
+#define DETECT_CONFIRM		3
+
+// Stick deflection still counted as idle, on 0x80 centered axes
+#define DETECT_STICK_SLACK	0x20
+
+int detectPad();
+bool detect_changed(bool idle);
+
+static inline bool detect_stick_idle(uint8_t x, uint8_t y) {
+	return (uint8_t) (x - (0x80 - DETECT_STICK_SLACK)) <= 2 * DETECT_STICK_SLACK &&
+			(uint8_t) (y - (0x80 - DETECT_STICK_SLACK)) <= 2 * DETECT_STICK_SLACK;
+}
+
+#endif /* DETECT_H_ */
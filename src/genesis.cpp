@@ -19,6 +19,7 @@
 #include <WProgram.h>
 #include "genesis.h"
 #include "digitalWriteFast.h"
+#include "ticks.h"
 
 #define DB9P1 5
 #define DB9P2 6
@@ -30,6 +31,13 @@
 
 #define DELAY 14
 
+// Time a 6-button pad needs to reset its select counter after a full read
+#define SIX_BUTTON_RESET_US 2000
+
+static bool six_button_wait = false;
+static uint16_t six_button_ticks;
+static int last_buttons;
+
 void genesis_init() {
 	pinModeFast(DB9P1, INPUT);
 	pinModeFast(DB9P2, INPUT);
@@ -48,62 +56,94 @@ void genesis_init() {
 	digitalWriteFast(DB9P9, HIGH);
 }
 
+/*
+ * All DB9 lines sit on PORTD (pins 5-7) and PORTB (pins 8-11), so each select
+ * phase is sampled at once with one PIND and one PINB read.
+ *
+ * Decoded bits (active high): 0 = P1, 1 = P2, 2 = P3, 3 = P4, 4 = P6, 5 = P9
+ */
+static inline byte genesis_lines() {
+	byte d = PIND;
+	byte b = PINB;
+
+	return ~((d >> 5) | ((b & 0x03) << 3) | ((b & 0x08) << 2)) & 0x3F;
+}
+
 int genesis_read() {
 	int retval;
+	byte lines;
 
 	int extrabuttons = 0;
 	int normalbuttons = 0;
 
+	// A 6-button pad is still resetting its select counter: reading it now
+	// would land on the wrong phase, so hand back the last sample instead of
+	// busy-waiting. The caller keeps servicing USB in the meantime.
+	if(six_button_wait) {
+		if((uint16_t)(ticks_now() - six_button_ticks) < TICKS_US(SIX_BUTTON_RESET_US))
+			return last_buttons;
+
+		six_button_wait = false;
+	}
+
 	// Get D-PAD, B, C buttons state
 	digitalWriteFast(DB9P7, HIGH);
 	delayMicroseconds(DELAY);
 
-	normalbuttons |= (!digitalReadFast(DB9P1) << 0);
-	normalbuttons |= (!digitalReadFast(DB9P2) << 1);
-	normalbuttons |= (!digitalReadFast(DB9P3) << 2);
-	normalbuttons |= (!digitalReadFast(DB9P4) << 3);
-	normalbuttons |= (!digitalReadFast(DB9P6) << 4);
-	normalbuttons |= (!digitalReadFast(DB9P9) << 5);
+	normalbuttons = genesis_lines();
 
 	digitalWriteFast(DB9P7, LOW);
 	delayMicroseconds(DELAY);
 
+	lines = genesis_lines();
+
+	// Select idles high between reads, like a console leaves it. Detection
+	// (see detect.h) then samples DB9P7 without giving the pad an edge.
+	digitalWriteFast(DB9P7, HIGH);
+
 	// Is using a SEGA Genesis controller, LEFT and RIGHT will be ACTIVE here
-	if(!(!digitalReadFast(DB9P3) && !digitalReadFast(DB9P4))) {
+	if((lines & 0x0C) != 0x0C) {
 		retval = normalbuttons | (extrabuttons << 8);
 		return retval;
 	}
 
-	// Get A and START buttons state
-	normalbuttons |= (!digitalReadFast(DB9P6) << 6);
-	normalbuttons |= (!digitalReadFast(DB9P9) << 7);
+	// Get A and START buttons state (P6 and P9)
+	normalbuttons |= (lines & 0x30) << 2;
 
-	digitalWriteFast(DB9P7, HIGH);
 	delayMicroseconds(DELAY);
 	digitalWriteFast(DB9P7, LOW);
 	delayMicroseconds(DELAY);
 
 	// Up, Down, Left and Right are low if 6-button controller
-	if(!digitalReadFast(DB9P1) && !digitalReadFast(DB9P2) && !digitalReadFast(DB9P3) && !digitalReadFast(DB9P4)) {
+	if((genesis_lines() & 0x0F) == 0x0F) {
 		digitalWriteFast(DB9P7, HIGH);
 		delayMicroseconds(DELAY);
 
-		extrabuttons |= (!digitalReadFast(DB9P1) << 0);
-		extrabuttons |= (!digitalReadFast(DB9P2) << 1);
-		extrabuttons |= (!digitalReadFast(DB9P3) << 2);
-		extrabuttons |= (!digitalReadFast(DB9P4) << 3);
+		extrabuttons = genesis_lines() & 0x0F;
 
 		digitalWriteFast(DB9P7, LOW);
 		delayMicroseconds(DELAY);
 		digitalWriteFast(DB9P7, HIGH);
-		delayMicroseconds(DELAY);
-		digitalWriteFast(DB9P7, LOW);
 
-		// Delay needed for settling joystick down
-		delayMicroseconds(2000);
+		// Pad needs time for settling down, don't read it again until then
+		six_button_ticks = ticks_now();
+		six_button_wait = true;
+	} else {
+		digitalWriteFast(DB9P7, HIGH);
 	}
 
 	retval = normalbuttons | (extrabuttons << 8);
 
+	last_buttons = retval;
+
 	return retval;
 }
+
+// True while select is high and a 6-button pad's counter has reset, so
+// DB9P7 can be sampled without moving the pad to another phase
+bool genesis_quiet() {
+	if(six_button_wait)
+		return (uint16_t)(ticks_now() - six_button_ticks) >= TICKS_US(SIX_BUTTON_RESET_US);
+
+	return true;
+}
@@ -21,6 +21,7 @@
 
 void genesis_init();
 int genesis_read();
+bool genesis_quiet();
 
 #define GENESIS_UP 0x01
 #define GENESIS_DOWN 0x02
@@ -0,0 +1,237 @@
+/*
+* USB RetroPad Adapter - PC/PS3 USB adapter for retro-controllers!
+* Copyright (c) 2012 Bruno Freitas - bruno@brunofreitas.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <avr/eeprom.h>
+#include "macro.h"
+#include "settings.h"
+
+// As many slots as fit in the EEPROM, up to 4
+#if (E2END + 1 - EE_MACRO) / MACRO_SLOT_SIZE < 4
+#define MACRO_SLOTS ((E2END + 1 - EE_MACRO) / MACRO_SLOT_SIZE)
+#else
+#define MACRO_SLOTS 4
+#endif
+
+// EEPROM slot layout: trigger bit (0xFF = empty), step count, steps
+#define SLOT_ADDRESS(slot)	(EE_MACRO + (slot) * MACRO_SLOT_SIZE)
+
+typedef struct {
+	uint16_t buttons;
+	uint8_t frames;
+} macro_step_t;
+
+uint8_t macro_state = MACRO_IDLE;
+uint16_t macro_watch;
+
+static uint16_t chord_mask;
+static uint16_t trigger_mask;
+
+static uint8_t wait_next;		// state to enter once...
+static uint16_t wait_mask;		// ...these buttons are released
+
+static uint8_t slot;
+static uint8_t trigger;
+static uint8_t step;
+static uint8_t steps;
+static macro_step_t current;
+static macro_step_t recording[MACRO_STEPS];
+static uint8_t header[2];		// trigger and step count being saved
+
+static uint8_t slot_trigger(uint8_t n) {
+	return eeprom_read_byte((const uint8_t *) SLOT_ADDRESS(n));
+}
+
+static void load_triggers() {
+	uint8_t bit;
+
+	trigger_mask = 0;
+
+	for(uint8_t n = 0; n < MACRO_SLOTS; n++) {
+		bit = slot_trigger(n);
+
+		if(bit < 16)
+			trigger_mask |= 1U << bit;
+	}
+
+	macro_watch = chord_mask | trigger_mask;
+}
+
+// Loads the bound buttons; chord is the raw button combination that starts
+// and stops a recording
+void macro_init(uint16_t chord) {
+	chord_mask = chord;
+	macro_state = MACRO_IDLE;
+
+	// A slot still being saved loads them once it's written
+	if(!settings_pending(header))
+		load_triggers();
+}
+
+static void wait_release(uint16_t mask, uint8_t next) {
+	wait_mask = mask;
+	wait_next = next;
+	macro_state = MACRO_WAIT;
+}
+
+static void load_step() {
+	eeprom_read_block(&current, (const void *) (SLOT_ADDRESS(slot) + 2 + step * 3), 3);
+}
+
+static void start_play(uint16_t pressed) {
+	for(slot = 0; slot < MACRO_SLOTS; slot++) {
+		trigger = slot_trigger(slot);
+
+		if(trigger < 16 && (pressed & (1U << trigger)))
+			break;
+	}
+
+	if(slot < MACRO_SLOTS)
+		steps = eeprom_read_byte((const uint8_t *) (SLOT_ADDRESS(slot) + 1));
+
+	if(slot == MACRO_SLOTS || !steps || steps > MACRO_STEPS) {
+		wait_release(pressed, MACRO_IDLE);
+		return;
+	}
+
+	step = 0;
+	load_step();
+	macro_state = MACRO_PLAY;
+}
+
+static void start_record(uint16_t pressed) {
+	trigger = 0;
+
+	while(!(pressed & (1U << trigger)))
+		trigger++;
+
+	// Reuse the slot of this button, else an empty one, else the last one
+	for(slot = 0; slot < MACRO_SLOTS - 1; slot++) {
+		if(slot_trigger(slot) == trigger)
+			break;
+	}
+
+	if(slot_trigger(slot) != trigger) {
+		for(slot = 0; slot < MACRO_SLOTS - 1; slot++) {
+			if(slot_trigger(slot) == 0xFF)
+				break;
+		}
+	}
+
+	steps = 0;
+	current.frames = 0;
+
+	wait_release(1U << trigger, MACRO_RECORD);
+}
+
+// Queues the slot for settings_task(), steps first so a slot whose header is
+// in always has its steps. Bound buttons stay off until it's all written,
+// neither the slot nor the recording buffer may change before that.
+static void save_record() {
+	if(current.frames && steps < MACRO_STEPS)
+		recording[steps++] = current;
+
+	if(!steps)
+		return;
+
+	header[0] = trigger;
+	header[1] = steps;
+
+	trigger_mask = 0;
+	macro_watch = 0;
+
+	settings_write(SLOT_ADDRESS(slot) + 2, (const uint8_t *) recording, steps * 3, 0);
+	settings_write(SLOT_ADDRESS(slot), header, 2, load_triggers);
+}
+
+static uint16_t record(uint16_t buttons) {
+	// Nothing is recorded until the first button goes down
+	if(!steps && !current.frames && !buttons)
+		return buttons;
+
+	if(current.frames && current.buttons == buttons && current.frames < 0xFF) {
+		current.frames++;
+		return buttons;
+	}
+
+	if(current.frames)
+		recording[steps++] = current;
+
+	current.buttons = buttons;
+	current.frames = 1;
+
+	if(steps == MACRO_STEPS - 1) {
+		save_record();
+		wait_release(buttons, MACRO_IDLE);
+	}
+
+	return buttons;
+}
+
+static uint16_t play() {
+	uint16_t buttons = current.buttons;
+
+	if(--current.frames == 0) {
+		if(++step < steps)
+			load_step();
+		else
+			wait_release(1U << trigger, MACRO_IDLE);
+	}
+
+	return buttons;
+}
+
+// Runs one frame of the macro engine, returns the buttons to report
+uint16_t macro_frame(uint16_t buttons) {
+	switch(macro_state) {
+	case MACRO_WAIT:
+		if(!(buttons & wait_mask))
+			macro_state = wait_next;
+		return buttons & ~wait_mask;
+	case MACRO_BIND:
+		if(buttons & ~chord_mask)
+			start_record(buttons & ~chord_mask);
+		return 0;
+	case MACRO_RECORD:
+		if((buttons & chord_mask) == chord_mask) {
+			// Drop the frames spent pressing the chord
+			if(current.buttons & chord_mask)
+				current.frames = 0;
+
+			save_record();
+			wait_release(chord_mask, MACRO_IDLE);
+			return 0;
+		}
+		return record(buttons);
+	case MACRO_PLAY:
+		return play();
+	}
+
+	if(chord_mask && (buttons & chord_mask) == chord_mask) {
+		wait_release(chord_mask, MACRO_BIND);
+		return 0;
+	}
+
+	if(buttons & trigger_mask) {
+		start_play(buttons & trigger_mask);
+
+		if(macro_state == MACRO_PLAY)
+			return play();
+	}
+
+	return buttons;
+}
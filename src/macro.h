@@ -0,0 +1,67 @@
+/*
+* USB RetroPad Adapter - PC/PS3 USB adapter for retro-controllers!
+* Copyright (c) 2012 Bruno Freitas - bruno@brunofreitas.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MACRO_H_
+#define MACRO_H_
+
+#include <stdint.h>
+
+/*
+ * Input macros: a button bound to a recorded sequence of button words.
+ *
+ * Sequences are run-length encoded, { word, frames } steps, and kept in
+ * EEPROM slots along with the raw button bit that triggers them. A frame is
+ * one report: while a macro is being recorded or played the pad loop waits
+ * for the last report to go out whole before sampling (vs_wait_report()), so
+ * playback repeats the recording frame by frame. A finished recording is
+ * written to EEPROM a byte per frame by settings_task(); bound buttons are
+ * off until it's in.
+ *
+ * Recording: hold the chord given to macro_init() and release it, press the
+ * button to bind, release it, then play the sequence. Hold the chord again
+ * to stop and save. Pressing a bound button plays its macro, which replaces
+ * the pad's buttons until it ends.
+ *
+ * While idle, the pad loop only tests macro_engaged(): the state byte and
+ * one AND against the chord and trigger bits.
+ */
+#define MACRO_STEPS		32
+#define MACRO_SLOT_SIZE	(2 + MACRO_STEPS * 3)
+
+#define MACRO_IDLE		0
+#define MACRO_WAIT		1
+#define MACRO_BIND		2
+#define MACRO_RECORD	3
+#define MACRO_PLAY		4
+
+extern uint8_t macro_state;
+extern uint16_t macro_watch;
+
+void macro_init(uint16_t chord);
+uint16_t macro_frame(uint16_t buttons);
+
+static inline bool macro_engaged(uint16_t buttons) {
+	return macro_state || (buttons & macro_watch);
+}
+
+// True while each frame has to take one report slot
+static inline bool macro_synced() {
+	return macro_state == MACRO_RECORD || macro_state == MACRO_PLAY;
+}
+
+#endif /* MACRO_H_ */
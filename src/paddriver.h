@@ -0,0 +1,185 @@
+/*
+* USB RetroPad Adapter - PC/PS3 USB adapter for retro-controllers!
+* Copyright (c) 2012 Bruno Freitas - bruno@brunofreitas.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PADDRIVER_H_
+#define PADDRIVER_H_
+
+#include "padmap.h"
+#include "genesis.h"
+#include "saturn.h"
+#include "tg16.h"
+#include "NESPad.h"
+
+/*
+ * Digital pad drivers.
+ *
+ * Each driver is a struct of static members that digital_loop() (in each
+ * usbra.cpp) is instantiated with, so every pad gets its own loop with the
+ * driver calls and constants inlined and no function pointers:
+ *
+ *   state_t   raw button word, as padmap_apply() takes it
+ *   padmap    PADMAP_* slot for remap, turbo and SOCD settings
+ *   caps      PAD_CAP_* bits, tested at compile time
+ *   up ...    raw bits of the four directions, for padmap_dir()
+ *   init()    sets the pad lines up
+ *   players   pads read by each poll(), player 1 first
+ *   poll()    reads the pads, returns player 1's word, 1 bits are pressed
+ *   poll_player(n)  player n's word (1 .. players - 1) from the last poll()
+ *   quiet()   true while detection may sample the pad lines (see detect.h)
+ *   extra_bytes     bytes of extra buttons past the raw word
+ *   poll_extra()    extra buttons from the last poll(), for VS_EXTRA_BUTTONS
+ *
+ * DigitalDriver has the defaults. Adding a digital pad means a struct here
+ * and its mapping tables.
+ */
+#define PAD_CAP_MACRO		0x01	// macro record/playback (see macro.h)
+
+// Data line of the second pad in multiplayer builds (USB_CFG_PLAYERS),
+// sharing clock and latch with the first pad. DB9 pin 4 is free on the
+// NES, SNES and arcade cables. A Four Score puts players 3 and 4 on the same
+// two lines; a SNES multitap also needs its IO line, on the free DB9 pin 9.
+#if USB_CFG_PLAYERS > 1
+#define PAD_DATA2_PIN	8
+#else
+#define PAD_DATA2_PIN	-1
+#endif
+
+#if USB_CFG_PLAYERS > 2
+#define PAD_IO_PIN		11
+#define PAD_TAP_PLAYERS	4
+#elif USB_CFG_PLAYERS > 1
+#define PAD_IO_PIN		-1
+#define PAD_TAP_PLAYERS	2
+#else
+#define PAD_IO_PIN		-1
+#define PAD_TAP_PLAYERS	1
+#endif
+
+// Arcade shift register chain: the raw word, then USB_CFG_EXTRA_BUTTONS
+// more bits (the XBOX build has no room for them)
+#ifdef USB_CFG_EXTRA_BUTTONS
+#define ARCADE_CHAIN_BYTES	(2 + USB_CFG_EXTRA_BUTTONS / 8)
+#else
+#define ARCADE_CHAIN_BYTES	2
+#endif
+
+struct DigitalDriver {
+	typedef int state_t;
+	enum { caps = 0, players = 1, extra_bytes = 0 };
+
+	static bool quiet() { return true; }
+	static state_t poll_player(uint8_t) { return 0; }
+	static const uint8_t *poll_extra() { return 0; }
+};
+
+// Pads read by the last tap poll, players 2 to 4
+struct TapDriver : DigitalDriver {
+	enum { players = PAD_TAP_PLAYERS };
+
+	static state_t *pads() { static state_t p[4]; return p; }
+	static state_t poll_player(uint8_t n) { return pads()[n]; }
+};
+
+struct GenesisDriver : DigitalDriver {
+	enum { padmap = PADMAP_GENESIS };
+	enum { up = GENESIS_UP, down = GENESIS_DOWN, left = GENESIS_LEFT, right = GENESIS_RIGHT };
+
+	static void init() { genesis_init(); }
+	static state_t poll() { return genesis_read(); }
+	static bool quiet() { return genesis_quiet(); }
+};
+
+struct ArcadeDriver : DigitalDriver {
+	enum { padmap = PADMAP_ARCADE, caps = PAD_CAP_MACRO };
+	enum { players = PAD_TAP_PLAYERS > 1 ? 2 : 1, extra_bytes = ARCADE_CHAIN_BYTES - 2 };
+	enum { up = 0x01, down = 0x02, left = 0x04, right = 0x08 };
+
+	static uint8_t *chain() { static uint8_t c[ARCADE_CHAIN_BYTES]; return c; }
+
+	static void init() { NESPad::init(6, 7, 13, PAD_DATA2_PIN); }
+
+	static state_t poll() {
+		NESPad::read_chain(chain(), ARCADE_CHAIN_BYTES);
+		return chain()[0] | chain()[1] << 8;
+	}
+
+	static state_t poll_player(uint8_t) { return NESPad::second(); }
+	static const uint8_t *poll_extra() { return chain() + 2; }
+};
+
+struct NESDriver : TapDriver {
+	enum { padmap = PADMAP_NES };
+	enum { up = 16, down = 32, left = 64, right = 128 };
+
+	static void init() { NESPad::init(5, 6, 7, PAD_DATA2_PIN); }
+
+	static state_t poll() {
+		if(players > 2) {
+			NESPad::read_four_score(pads());
+			return pads()[0];
+		}
+
+		state_t b = NESPad::read(8);
+		pads()[1] = NESPad::second();
+		return b;
+	}
+};
+
+struct SNESDriver : TapDriver {
+	enum { padmap = PADMAP_SNES };
+	enum { up = 16, down = 32, left = 64, right = 128 };
+
+	static void init() { NESPad::init(5, 6, 7, PAD_DATA2_PIN, PAD_IO_PIN); }
+
+	static state_t poll() {
+		if(players > 2) {
+			NESPad::read_multitap(pads());
+			return pads()[0];
+		}
+
+		state_t b = NESPad::read(16);
+		pads()[1] = NESPad::second();
+		return b;
+	}
+};
+
+struct NeoGeoDriver : DigitalDriver {
+	enum { padmap = PADMAP_NEOGEO };
+	enum { up = 0x04, down = 0x1000, left = 0x02, right = 0x800 };
+
+	static void init() { NESPad::init(5, 6, 7); }
+	static state_t poll() { return NESPad::read(16); }
+};
+
+struct SaturnDriver : DigitalDriver {
+	enum { padmap = PADMAP_SATURN };
+	enum { up = SATURN_UP, down = SATURN_DOWN, left = SATURN_LEFT, right = SATURN_RIGHT };
+
+	static void init() { saturn_init(); }
+	static state_t poll() { return saturn_read(); }
+};
+
+struct TG16Driver : DigitalDriver {
+	enum { padmap = PADMAP_TG16 };
+	enum { up = 1 << TG16_UP, down = 1 << TG16_DOWN, left = 1 << TG16_LEFT, right = 1 << TG16_RIGHT };
+
+	static void init() { tg16_init(); }
+	static state_t poll() { return tg16_read(); }
+};
+
+#endif /* PADDRIVER_H_ */
@@ -0,0 +1,131 @@
+/*
+* USB RetroPad Adapter - PC/PS3 USB adapter for retro-controllers!
+* Copyright (c) 2012 Bruno Freitas - bruno@brunofreitas.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <avr/eeprom.h>
+#include <string.h>
+#include "padmap.h"
+#include "settings.h"
+#include "turbo.h"
+#include "socd.h"
+
+// Remap of the current pad: raw bit mask feeding each bit of the word
+static uint16_t remap_mask[16];
+static uint8_t remap_pad;
+static bool remap_active;
+
+// Table on its way to EEPROM (see settings_write())
+static uint8_t store_source[16];
+static uint8_t store_pad;
+
+// Reads a pad's remap table, erased or invalid entries read as unchanged
+void padmap_read(uint8_t pad, uint8_t *source) {
+	eeprom_read_block(source, (const void *) (EE_REMAP + pad * 16), 16);
+
+	for(uint8_t i = 0; i < 16; i++) {
+		if(source[i] > 15)
+			source[i] = i;
+	}
+}
+
+static void padmap_stored() {
+	if(store_pad == remap_pad)
+		padmap_load(store_pad);
+}
+
+// Queues a pad's table for EEPROM, false while the last one is still going in
+bool padmap_store(uint8_t pad, const uint8_t *source) {
+	if(settings_pending(store_source))
+		return false;
+
+	memcpy(store_source, source, 16);
+	store_pad = pad;
+
+	return settings_write(EE_REMAP + pad * 16, store_source, 16, padmap_stored);
+}
+
+// Makes pad's remap table (and turbo and SOCD settings) the ones in use
+void padmap_load(uint8_t pad) {
+	uint8_t source[16];
+
+	turbo_load(pad);
+	socd_load(pad);
+
+	padmap_read(pad, source);
+
+	remap_pad = pad;
+	remap_active = false;
+
+	for(uint8_t i = 0; i < 16; i++) {
+		if(source[i] != i)
+			remap_active = true;
+
+		remap_mask[i] = 1U << source[i];
+	}
+}
+
+uint8_t padmap_current() {
+	return remap_pad;
+}
+
+// Raw bit that feeds bit of the remapped word
+uint8_t padmap_source(uint8_t bit) {
+	uint8_t source = 0;
+
+	if(!remap_active)
+		return bit;
+
+	while(!(remap_mask[bit] & (1U << source)))
+		source++;
+
+	return source;
+}
+
+void padmap_apply(const padmap_t *map, uint16_t buttons, uint8_t *report) {
+	uint16_t mask;
+	uint8_t *out;
+	uint8_t bits;
+
+	if(remap_active) {
+		uint16_t remapped = 0;
+
+		mask = 1;
+
+		for(uint8_t i = 0; i < 16; i++) {
+			if(buttons & remap_mask[i])
+				remapped |= mask;
+
+			mask <<= 1;
+		}
+
+		buttons = remapped;
+	}
+
+	buttons = turbo_buttons(buttons);
+
+	while((mask = pgm_read_word(&map->mask))) {
+		out = report + pgm_read_byte(&map->offset);
+		bits = pgm_read_byte(&map->bits);
+
+		if((buttons & mask) == mask)
+			*out |= bits;
+		else
+			*out &= ~bits;
+
+		map++;
+	}
+}
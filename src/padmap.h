@@ -0,0 +1,90 @@
+/*
+* USB RetroPad Adapter - PC/PS3 USB adapter for retro-controllers!
+* Copyright (c) 2012 Bruno Freitas - bruno@brunofreitas.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PADMAP_H_
+#define PADMAP_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/pgmspace.h>
+
+/*
+ * Table driven button mapping.
+ *
+ * Each pad has one PROGMEM table per output target (PS3 report, XBOX report).
+ * An entry sets 'bits' in byte 'offset' of the output report when all bits
+ * of 'mask' are set in the pad's raw button word, and clears them otherwise.
+ * Button combos (e.g. SELECT + START = PS) are entries with several mask bits.
+ * Tables end with a zero mask.
+ *
+ * Before a table is applied, the raw button word goes through the remap
+ * table of the current pad (see padmap_load()): bit i of the word takes the
+ * state of raw bit source[i]. The tables live in EEPROM, erased entries
+ * meaning "unchanged", and cost nothing while a pad has no remapping.
+ * The remapped word is then masked with the turbo phases (see turbo.h).
+ */
+typedef struct {
+	uint16_t mask;
+	uint8_t offset;
+	uint8_t bits;
+} padmap_t;
+
+void padmap_apply(const padmap_t *map, uint16_t buttons, uint8_t *report);
+
+// Pads with their own remap table
+#define PADMAP_ARCADE	0
+#define PADMAP_GENESIS	1
+#define PADMAP_NES		2
+#define PADMAP_SNES		3
+#define PADMAP_PS2		4
+#define PADMAP_GC		5
+#define PADMAP_N64		6
+#define PADMAP_NEOGEO	7
+#define PADMAP_SATURN	8
+#define PADMAP_TG16		9
+#define PADMAP_PADS		10
+
+void padmap_load(uint8_t pad);
+uint8_t padmap_current();
+uint8_t padmap_source(uint8_t bit);
+void padmap_read(uint8_t pad, uint8_t *source);
+bool padmap_store(uint8_t pad, const uint8_t *source);
+
+// Direction nibble, same bit order as the XBOX digital buttons. Loops pass
+// the nibble of the pad's directions through socd_resolve() (see socd.h).
+#define PADMAP_UP		0x01
+#define PADMAP_DOWN		0x02
+#define PADMAP_LEFT		0x04
+#define PADMAP_RIGHT	0x08
+
+static inline uint8_t padmap_dir(uint16_t buttons, uint16_t up, uint16_t down, uint16_t left, uint16_t right) {
+	uint8_t dir = 0;
+
+	if(buttons & up)
+		dir |= PADMAP_UP;
+	if(buttons & down)
+		dir |= PADMAP_DOWN;
+	if(buttons & left)
+		dir |= PADMAP_LEFT;
+	if(buttons & right)
+		dir |= PADMAP_RIGHT;
+
+	return dir;
+}
+
+#endif /* PADMAP_H_ */
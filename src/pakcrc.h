@@ -0,0 +1,65 @@
+/*
+* USB RetroPad Adapter - PC/PS3 USB adapter for retro-controllers!
+* Copyright (c) 2012 Bruno Freitas - bruno@brunofreitas.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PAKCRC_H_
+#define PAKCRC_H_
+
+#include <stdint.h>
+
+/*
+ * Checksums of the N64 controller pak commands (0x02 read, 0x03 write),
+ * apart from GCPad_16Mhz.cpp so they can be checked off the AVR.
+ */
+
+// 5 bit CRC of a pak address, sent in its low bits. Entries are the
+// syndromes of address bits 15 down to 5.
+static inline uint16_t pak_address(uint16_t address) {
+	static const uint8_t syndrome[11] = {0x01, 0x1A, 0x0D, 0x1C, 0x0E, 0x07, 0x19, 0x16, 0x0B, 0x1F, 0x15};
+	uint8_t crc = 0;
+
+	address &= 0xFFE0;
+
+	for(uint8_t i = 0; i < 11; i++) {
+		if(address & (0x8000 >> i))
+			crc ^= syndrome[i];
+	}
+
+	return address | crc;
+}
+
+// CRC (polynomial 0x85) the controller returns after each 32 byte block
+static inline uint8_t pak_data_crc(const uint8_t *data) {
+	uint8_t crc = 0;
+
+	for(uint8_t i = 0; i <= 32; i++) {
+		for(uint8_t mask = 0x80; mask; mask >>= 1) {
+			uint8_t poly = (crc & 0x80) ? 0x85 : 0x00;
+
+			crc <<= 1;
+
+			if(i < 32 && (data[i] & mask))
+				crc |= 0x01;
+
+			crc ^= poly;
+		}
+	}
+
+	return crc;
+}
+
+#endif /* PAKCRC_H_ */
@@ -46,6 +46,19 @@ void saturn_init() {
 	digitalWriteFast(S1, HIGH);
 }
 
+/*
+ * Data lines are split between PORTD (D0, D1) and PORTB (D2, D3), so each
+ * select phase is sampled at once with one PIND and one PINB read.
+ *
+ * Decoded nibble (active high): bit 0 = D0, 1 = D1, 2 = D2, 3 = D3
+ */
+static inline byte saturn_nibble() {
+	byte d = PIND;
+	byte b = PINB;
+
+	return ~(((d >> 6) & 0x01) | ((d >> 4) & 0x02) | ((b >> 1) & 0x04) | ((b << 1) & 0x08)) & 0x0F;
+}
+
 int saturn_read() {
 	int retval = 0;
 
@@ -62,37 +75,28 @@ int saturn_read() {
 	digitalWriteFast(S1, HIGH);
 	delayMicroseconds(DELAY);
 
-	retval |= (!digitalReadFast(D3) << 12); // L
+	retval |= (saturn_nibble() & 0x08) << 9; // L
 
 	// Reading Z, Y, X and R
 	digitalWriteFast(S0, LOW);
 	digitalWriteFast(S1, LOW);
 	delayMicroseconds(DELAY);
 
-	retval |= (!digitalReadFast(D0) << 0); // Z
-	retval |= (!digitalReadFast(D1) << 1); // Y
-	retval |= (!digitalReadFast(D2) << 2); // X
-	retval |= (!digitalReadFast(D3) << 3); // R
+	retval |= saturn_nibble();
 
 	// Reading B, C, A and Start
 	digitalWriteFast(S0, HIGH);
 	digitalWriteFast(S1, LOW);
 	delayMicroseconds(DELAY);
 
-	retval |= (!digitalReadFast(D0) << 4); // B
-	retval |= (!digitalReadFast(D1) << 5); // C
-	retval |= (!digitalReadFast(D2) << 6); // A
-	retval |= (!digitalReadFast(D3) << 7); // Start
+	retval |= saturn_nibble() << 4;
 
 	// Reading Up, Down, Left, Right
 	digitalWriteFast(S0, LOW);
 	digitalWriteFast(S1, HIGH);
 	delayMicroseconds(DELAY);
 
-	retval |= (!digitalReadFast(D0) << 8); // Up
-	retval |= (!digitalReadFast(D1) << 9); // Down
-	retval |= (!digitalReadFast(D2) << 10); // Left
-	retval |= (!digitalReadFast(D3) << 11); // Right
+	retval |= saturn_nibble() << 8;
 
 	return retval;
 }
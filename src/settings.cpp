@@ -0,0 +1,87 @@
+/*
+* USB RetroPad Adapter - PC/PS3 USB adapter for retro-controllers!
+* Copyright (c) 2012 Bruno Freitas - bruno@brunofreitas.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <avr/eeprom.h>
+#include "settings.h"
+
+typedef struct {
+	uint16_t address;
+	const uint8_t *data;
+	uint8_t length;
+	uint8_t offset;
+	settings_done_t done;
+} settings_block_t;
+
+static settings_block_t queue[SETTINGS_QUEUE];
+static uint8_t head;
+static uint8_t count;
+
+// Queues a block, false if the queue is full
+bool settings_write(uint16_t address, const uint8_t *data, uint8_t length, settings_done_t done) {
+	settings_block_t *block;
+
+	if(count == SETTINGS_QUEUE)
+		return false;
+
+	block = &queue[(head + count) % SETTINGS_QUEUE];
+	block->address = address;
+	block->data = data;
+	block->length = length;
+	block->offset = 0;
+	block->done = done;
+	count++;
+
+	return true;
+}
+
+bool settings_pending(const uint8_t *data) {
+	for(uint8_t i = 0; i < count; i++) {
+		if(queue[(head + i) % SETTINGS_QUEUE].data == data)
+			return true;
+	}
+
+	return false;
+}
+
+void settings_task() {
+	settings_block_t *block = &queue[head];
+	uint8_t *address;
+	uint8_t value;
+
+	// Still programming the last byte
+	if(!count || !eeprom_is_ready())
+		return;
+
+	while(block->offset < block->length) {
+		address = (uint8_t *) (block->address + block->offset);
+		value = block->data[block->offset++];
+
+		if(eeprom_read_byte(address) != value) {
+			eeprom_write_byte(address, value);
+			return;
+		}
+	}
+
+	// Every byte is in, and the EEPROM is ready for done() to read them back
+	if(++head == SETTINGS_QUEUE)
+		head = 0;
+	count--;
+
+	if(block->done)
+		block->done();
+}
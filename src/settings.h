@@ -0,0 +1,55 @@
+/*
+* USB RetroPad Adapter - PC/PS3 USB adapter for retro-controllers!
+* Copyright (c) 2012 Bruno Freitas - bruno@brunofreitas.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SETTINGS_H_
+#define SETTINGS_H_
+
+#include <stdint.h>
+
+/*
+ * EEPROM layout of the user settings. Erased EEPROM (all 0xFF) means
+ * "defaults" for every block, so a freshly flashed adapter behaves exactly
+ * like one without settings.
+ */
+#define EE_STICKMAP		0x000	// stickmap_config_t[STICKMAP_PADS][2], 24 bytes
+#define EE_REMAP		0x020	// uint8_t[PADMAP_PADS][16], 160 bytes
+#define EE_TURBO		0x0C0	// uint8_t[PADMAP_PADS][16], 160 bytes
+#define EE_SOCD			0x160	// uint8_t[PADMAP_PADS], 10 bytes
+#define EE_MACRO		0x170	// MACRO_SLOTS slots of MACRO_SLOT_SIZE bytes, to E2END
+
+/*
+ * Deferred EEPROM writes. Programming a byte takes 3.3ms, so writing a block
+ * in one go holds usbPoll() off well past the 50ms V-USB allows.
+ * settings_write() queues a block and returns; settings_task(), run by
+ * vs_send_pad_state() and xbox_send_pad_state() once per pass of the pad
+ * loop, programs at most one byte of it, skipping bytes that already hold
+ * their value, and calls done() once the whole block is in EEPROM. Blocks
+ * are written in the order they were queued. The data has to stay untouched
+ * until then, settings_pending() tells whether it still is; each owner has a
+ * single buffer and doesn't queue it again before that, so the queue never
+ * holds more than one block per buffer.
+ */
+#define SETTINGS_QUEUE	5	// macro slot (2 blocks), remap, turbo and SOCD
+
+typedef void (*settings_done_t)();
+
+bool settings_write(uint16_t address, const uint8_t *data, uint8_t length, settings_done_t done);
+bool settings_pending(const uint8_t *data);
+void settings_task();
+
+#endif /* SETTINGS_H_ */
@@ -0,0 +1,99 @@
+/*
+* USB RetroPad Adapter - PC/PS3 USB adapter for retro-controllers!
+* Copyright (c) 2012 Bruno Freitas - bruno@brunofreitas.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <avr/eeprom.h>
+#include "socd.h"
+#include "padmap.h"
+#include "settings.h"
+
+static uint8_t socd_mode = SOCD_OFF;
+static uint8_t socd_pad = 0xFF;
+
+// Mode on its way to EEPROM (see settings_write())
+static uint8_t store_mode;
+static uint8_t store_pad;
+
+// Raw and resolved nibbles of each player's previous sample
+static uint8_t last_dir[SOCD_PLAYERS];
+static uint8_t last_out[SOCD_PLAYERS];
+
+// Reads a pad's mode, erased or invalid entries read as off
+uint8_t socd_read(uint8_t pad) {
+	uint8_t mode = eeprom_read_byte((const uint8_t *) (EE_SOCD + pad));
+
+	return mode > SOCD_UP_PRIORITY ? SOCD_OFF : mode;
+}
+
+static void socd_stored() {
+	if(store_pad == socd_pad)
+		socd_load(store_pad);
+}
+
+// Queues a pad's mode for EEPROM, false while the last one is still going in
+bool socd_store(uint8_t pad, uint8_t mode) {
+	if(settings_pending(&store_mode))
+		return false;
+
+	store_mode = mode;
+	store_pad = pad;
+
+	return settings_write(EE_SOCD + pad, &store_mode, 1, socd_stored);
+}
+
+void socd_load(uint8_t pad) {
+	socd_pad = pad;
+	socd_mode = socd_read(pad);
+
+	for(uint8_t i = 0; i < SOCD_PLAYERS; i++) {
+		last_dir[i] = 0;
+		last_out[i] = 0;
+	}
+}
+
+uint8_t socd_resolve(uint8_t dir, uint8_t player) {
+	uint8_t out = dir;
+	uint8_t axis = PADMAP_UP | PADMAP_DOWN;
+
+	if(socd_mode == SOCD_OFF)
+		return dir;
+
+	for(uint8_t n = 0; n < 2; n++) {
+		if((dir & axis) == axis) {
+			out &= ~axis;
+
+			if(socd_mode == SOCD_LAST_WINS) {
+				uint8_t pressed = axis & ~last_dir[player];
+
+				// Both held: keep the winner. Both pressed at once: neutral.
+				if(!pressed)
+					out |= last_out[player] & axis;
+				else if(pressed != axis)
+					out |= pressed;
+			} else if(socd_mode == SOCD_UP_PRIORITY && axis & PADMAP_UP) {
+				out |= PADMAP_UP;
+			}
+		}
+
+		axis = PADMAP_LEFT | PADMAP_RIGHT;
+	}
+
+	last_dir[player] = dir;
+	last_out[player] = out;
+
+	return out;
+}
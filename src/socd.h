@@ -0,0 +1,50 @@
+/*
+* USB RetroPad Adapter - PC/PS3 USB adapter for retro-controllers!
+* Copyright (c) 2012 Bruno Freitas - bruno@brunofreitas.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SOCD_H_
+#define SOCD_H_
+
+#include <stdint.h>
+
+/*
+ * SOCD (simultaneous opposing cardinal directions) cleaning.
+ *
+ * socd_resolve() runs once per sample on the direction nibble of the pad
+ * (see padmap_dir()) and never lets both directions of an axis through:
+ *
+ *   SOCD_NEUTRAL      left + right and up + down are neutral
+ *   SOCD_LAST_WINS    the direction pressed last wins on each axis
+ *   SOCD_UP_PRIORITY  up + down is up, left + right is neutral
+ *
+ * The mode is stored in EEPROM per pad. Any other value (erased EEPROM)
+ * passes the nibble through, leaving opposing directions to each loop.
+ * Each player of a multiplayer pad keeps its own state.
+ */
+#define SOCD_NEUTRAL		0
+#define SOCD_LAST_WINS		1
+#define SOCD_UP_PRIORITY	2
+#define SOCD_OFF			0xFF
+
+#define SOCD_PLAYERS		4
+
+void socd_load(uint8_t pad);
+uint8_t socd_read(uint8_t pad);
+bool socd_store(uint8_t pad, uint8_t mode);
+uint8_t socd_resolve(uint8_t dir, uint8_t player = 0);
+
+#endif /* SOCD_H_ */
@@ -0,0 +1,130 @@
+/*
+* USB RetroPad Adapter - PC/PS3 USB adapter for retro-controllers!
+* Copyright (c) 2012 Bruno Freitas - bruno@brunofreitas.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <avr/eeprom.h>
+#include "stickmap.h"
+#include "settings.h"
+
+/*
+ * Per stick, indexed by distance from centre: the output distance, or for a
+ * radial stick the 8.8 scale (output / distance) both axes are multiplied by
+ */
+typedef union {
+	uint8_t axis[129];
+	uint16_t scale[129];
+} stickmap_table_t;
+
+static stickmap_table_t response[2];
+static bool radial[2];
+
+static void stickmap_build(uint8_t stick, stickmap_config_t *config) {
+	stickmap_table_t *table = &response[stick];
+	uint8_t deadzone = config->deadzone;
+	uint16_t position;
+	uint8_t out;
+
+	radial[stick] = config->flags & STICKMAP_RADIAL;
+
+	for(uint8_t d = 0; d <= 128; d++) {
+		if(d == 0 || d <= deadzone) {
+			out = 0;
+		} else {
+			// Position past the dead zone, 0..128. Rounding up keeps the full
+			// positive travel (127) at the top of the range.
+			position = ((uint16_t) (d - deadzone) * 128 + 127 - deadzone) / (128 - deadzone);
+
+			if(config->flags & STICKMAP_EXPONENTIAL)
+				position = (position * position + 127) / 128;
+
+			out = config->anti_deadzone + (position * (128 - config->anti_deadzone) + 127) / 128;
+		}
+
+		// Rounded up, an axis at offset <= d scales to at most out, and
+		// offset * scale stays under 128 * 256 + d
+		if(radial[stick])
+			table->scale[d] = out ? ((uint16_t) out * 256 + d - 1) / d : 0;
+		else
+			table->axis[d] = out;
+	}
+}
+
+// Loads the settings of an analog pad (STICKMAP_* pad) and builds its tables
+void stickmap_init(uint8_t pad) {
+	stickmap_config_t config;
+
+	for(uint8_t stick = STICKMAP_LEFT; stick <= STICKMAP_RIGHT; stick++) {
+		eeprom_read_block(&config, (const void *) (EE_STICKMAP + (pad * 2 + stick) * sizeof(config)), sizeof(config));
+
+		if(config.flags == 0xFF || config.deadzone > 127 || config.anti_deadzone > 127)
+			config.flags = config.deadzone = config.anti_deadzone = 0;
+
+		stickmap_build(stick, &config);
+	}
+}
+
+static inline uint8_t stickmap_axis(const uint8_t *table, uint8_t value) {
+	uint8_t offset;
+
+	if(value < 0x80)
+		return 0x80 - table[0x80 - value];
+
+	offset = table[value - 0x80];
+	return 0x80 + ((offset > 0x7F) ? 0x7F : offset);
+}
+
+// Moves an axis at offset from centre to offset * scale, keeping the
+// stick's direction
+static inline uint8_t stickmap_radial_axis(uint8_t value, uint8_t offset, uint16_t scale) {
+	offset = (uint16_t) (offset * scale) >> 8;
+
+	if(value < 0x80)
+		return 0x80 - offset;
+
+	return 0x80 + ((offset > 0x7F) ? 0x7F : offset);
+}
+
+void stickmap_apply(uint8_t stick, uint8_t *x, uint8_t *y) {
+	uint8_t dx, dy, distance;
+	uint16_t scale;
+
+	if(radial[stick]) {
+		// Octagonal estimate of the stick's distance from centre. Past 128
+		// (corners of a square gate) the stick keeps its position as it is
+		// at 128, so the corners keep their full range.
+		dx = (*x < 0x80) ? 0x80 - *x : *x - 0x80;
+		dy = (*y < 0x80) ? 0x80 - *y : *y - 0x80;
+		distance = (dx > dy) ? dx + (dy >> 1) : dy + (dx >> 1);
+
+		if(distance > 128)
+			distance = 128;
+
+		scale = response[stick].scale[distance];
+
+		if(!scale) {
+			*x = *y = 0x80;
+			return;
+		}
+
+		*x = stickmap_radial_axis(*x, dx, scale);
+		*y = stickmap_radial_axis(*y, dy, scale);
+		return;
+	}
+
+	*x = stickmap_axis(response[stick].axis, *x);
+	*y = stickmap_axis(response[stick].axis, *y);
+}
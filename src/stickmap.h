@@ -0,0 +1,57 @@
+/*
+* USB RetroPad Adapter - PC/PS3 USB adapter for retro-controllers!
+* Copyright (c) 2012 Bruno Freitas - bruno@brunofreitas.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STICKMAP_H_
+#define STICKMAP_H_
+
+#include <stdint.h>
+
+/*
+ * Analog stick processing: dead zone, anti-dead zone and response curve.
+ *
+ * Settings are kept in EEPROM per analog pad and per stick. At boot they are
+ * turned into one response table per stick, mapping the distance from centre
+ * (0..128) to the output distance, so applying them costs the same couple of
+ * table lookups whatever the settings are. Axes are 0x00..0xFF, 0x80 at rest.
+ * A radial stick's table holds the output distance over the distance instead:
+ * it is looked up once with the stick's distance from centre, and each axis
+ * takes one multiply and shift by it, which keeps the stick's direction.
+ */
+typedef struct {
+	uint8_t flags;			// STICKMAP_* flags below, 0xFF = erased (defaults)
+	uint8_t deadzone;		// distance from centre reported as centre, 0..127
+	uint8_t anti_deadzone;	// output distance just past the dead zone, 0..127
+	uint8_t reserved;
+} stickmap_config_t;
+
+#define STICKMAP_EXPONENTIAL	0x01	// squared response instead of linear
+#define STICKMAP_RADIAL			0x02	// curve on the stick's distance, not per axis
+
+// Analog pads with their own settings
+#define STICKMAP_PS2	0
+#define STICKMAP_GC		1
+#define STICKMAP_N64	2
+#define STICKMAP_PADS	3
+
+#define STICKMAP_LEFT	0
+#define STICKMAP_RIGHT	1
+
+void stickmap_init(uint8_t pad);
+void stickmap_apply(uint8_t stick, uint8_t *x, uint8_t *y);
+
+#endif /* STICKMAP_H_ */
@@ -41,8 +41,22 @@ void tg16_init(void) {
 	digitalWriteFast(11, LOW);
 }
 
+/*
+ * Data lines are split between PORTD (pins 5, 7) and PORTB (pins 8, 9), so each
+ * select phase is sampled at once with one PIND and one PINB read.
+ *
+ * Decoded nibble (active high): bit 0 = pin 5, 1 = pin 7, 2 = pin 8, 3 = pin 9
+ */
+static inline byte tg16_nibble(void) {
+	byte d = PIND;
+	byte b = PINB;
+
+	return ~(((d >> 5) & 0x01) | ((d >> 6) & 0x02) | ((b & 0x03) << 2)) & 0x0F;
+}
+
 int tg16_read(void) {
 	int retval = 0;
+	byte nibble;
 
 	// Data Select HIGH
 	digitalWriteFast(10, HIGH);
@@ -55,31 +69,24 @@ int tg16_read(void) {
 		digitalWriteFast(11, LOW);
 		delayMicroseconds(1);
 
+		nibble = tg16_nibble();
+
 		// If four directions are low, then it's an Avenue6 Pad
-		if(!digitalReadFast(5) && !digitalReadFast(7) && !digitalReadFast(8) && !digitalReadFast(9)) {
+		if(nibble == 0x0F) {
 			// Data Select LOW
 			digitalWriteFast(10, LOW);
 			delayMicroseconds(1);
 
-			retval |= (!digitalReadFast(5) << 8);  // III
-			retval |= (!digitalReadFast(7) << 9);  // IV
-			retval |= (!digitalReadFast(8) << 10); // V
-			retval |= (!digitalReadFast(9) << 11); // VI
+			retval |= tg16_nibble() << 8; // III, IV, V, VI
 		} else {
 			// Normal pad reading
-			retval |= (!digitalReadFast(5) << 0); // UP
-			retval |= (!digitalReadFast(7) << 1); // RIGHT
-			retval |= (!digitalReadFast(8) << 2); // DOWN
-			retval |= (!digitalReadFast(9) << 3); // LEFT
+			retval |= nibble; // UP, RIGHT, DOWN, LEFT
 
 			// Data Select LOW
 			digitalWriteFast(10, LOW);
 			delayMicroseconds(1);
 
-			retval |= (!digitalReadFast(5) << 4); // I
-			retval |= (!digitalReadFast(7) << 5); // II
-			retval |= (!digitalReadFast(8) << 6); // SELECT
-			retval |= (!digitalReadFast(9) << 7); // RUN
+			retval |= tg16_nibble() << 4; // I, II, SELECT, RUN
 		}
 
 		// Data Select HIGH
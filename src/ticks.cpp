@@ -0,0 +1,27 @@
+/*
+* USB RetroPad Adapter - PC/PS3 USB adapter for retro-controllers!
+* Copyright (c) 2012 Bruno Freitas - bruno@brunofreitas.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ticks.h"
+
+void ticks_init() {
+	// Timer1 in normal mode, clk/256, no interrupts. Arduino's init() sets it
+	// up for PWM on pins 9 and 10, which we don't use.
+	TCCR1A = 0;
+	TCCR1B = _BV(CS12);
+	TIMSK1 = 0;
+}
@@ -0,0 +1,35 @@
+/*
+* USB RetroPad Adapter - PC/PS3 USB adapter for retro-controllers!
+* Copyright (c) 2012 Bruno Freitas - bruno@brunofreitas.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TICKS_H_
+#define TICKS_H_
+
+#include <avr/io.h>
+
+// Timer1 is used as a free running time base, since millis() and micros()
+// don't work once vs_init() disables the timer 0 overflow interrupt.
+// One tick is 256 clock cycles (16us at 16Mhz), the counter wraps after ~1s.
+#define TICKS_US(us) ((uint16_t) ((us) * (F_CPU / 1000000UL) / 256))
+
+void ticks_init();
+
+static inline uint16_t ticks_now() {
+	return TCNT1;
+}
+
+#endif /* TICKS_H_ */
@@ -0,0 +1,150 @@
+/*
+* USB RetroPad Adapter - PC/PS3 USB adapter for retro-controllers!
+* Copyright (c) 2012 Bruno Freitas - bruno@brunofreitas.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <avr/eeprom.h>
+#include <avr/interrupt.h>
+#include <string.h>
+#include "turbo.h"
+#include "settings.h"
+
+volatile uint16_t turbo_mask = 0xFFFF;
+
+// Half period of each button in ticks (0 = no turbo) and ticks left in the
+// current half period
+static uint8_t turbo_reload[16];
+static uint8_t turbo_count[16];
+static uint8_t turbo_pad = 0xFF;
+
+// Buttons with turbo and the ones held at the last turbo_buttons() call
+static uint16_t turbo_bits;
+static volatile uint16_t turbo_held;
+
+// Rates on their way to EEPROM (see settings_write())
+static uint8_t store_rate[16];
+static uint8_t store_pad;
+
+// Reads a pad's turbo rates in Hz, erased or invalid entries read as off
+void turbo_read(uint8_t pad, uint8_t *rate) {
+	eeprom_read_block(rate, (const void *) (EE_TURBO + pad * 16), 16);
+
+	for(uint8_t i = 0; i < 16; i++) {
+		if(rate[i] < TURBO_MIN_HZ || rate[i] > TURBO_MAX_HZ)
+			rate[i] = 0;
+	}
+}
+
+static void turbo_stored() {
+	if(store_pad == turbo_pad)
+		turbo_load(store_pad);
+}
+
+// Queues a pad's rates for EEPROM, false while the last ones are still going in
+bool turbo_store(uint8_t pad, const uint8_t *rate) {
+	if(settings_pending(store_rate))
+		return false;
+
+	memcpy(store_rate, rate, 16);
+	store_pad = pad;
+
+	return settings_write(EE_TURBO + pad * 16, store_rate, 16, turbo_stored);
+}
+
+// Sets up the turbo buttons of pad and runs Timer2 if there are any
+void turbo_load(uint8_t pad) {
+	uint8_t rate[16];
+	bool active = false;
+
+	turbo_read(pad, rate);
+
+	TIMSK2 = 0;
+
+	turbo_pad = pad;
+	turbo_mask = 0xFFFF;
+	turbo_bits = 0;
+	turbo_held = 0;
+
+	for(uint8_t i = 0; i < 16; i++) {
+		turbo_reload[i] = rate[i] ? (TURBO_TICK_HZ + rate[i]) / (2 * rate[i]) : 0;
+		turbo_count[i] = turbo_reload[i];
+
+		if(rate[i]) {
+			turbo_bits |= 1U << i;
+			active = true;
+		}
+	}
+
+	if(!active)
+		return;
+
+	// CTC mode, clk/1024
+	TCCR2A = _BV(WGM21);
+	TCCR2B = _BV(CS22) | _BV(CS21) | _BV(CS20);
+	OCR2A = F_CPU / 1024 / TURBO_TICK_HZ - 1;
+	TCNT2 = 0;
+	TIFR2 = _BV(OCF2A);
+	TIMSK2 = _BV(OCIE2A);
+}
+
+// Applies turbo_mask to buttons without racing the timer interrupt. Turbo
+// buttons that just went down start a full "pressed" half period.
+uint16_t turbo_buttons(uint16_t buttons) {
+	uint8_t sreg = SREG;
+	uint16_t pressed, mask;
+
+	cli();
+
+	pressed = buttons & ~turbo_held & turbo_bits;
+
+	if(pressed) {
+		mask = 1;
+
+		for(uint8_t i = 0; i < 16; i++) {
+			if(pressed & mask)
+				turbo_count[i] = turbo_reload[i];
+
+			mask <<= 1;
+		}
+
+		turbo_mask |= pressed;
+	}
+
+	turbo_held = buttons;
+	mask = turbo_mask;
+	SREG = sreg;
+
+	return buttons & mask;
+}
+
+// Interrupts are re-enabled on entry so V-USB's interrupt is never held off.
+// Released buttons keep their count until the next press restarts it.
+ISR(TIMER2_COMPA_vect, ISR_NOBLOCK) {
+	uint16_t mask = turbo_mask;
+	uint16_t held = turbo_held;
+	uint16_t bit = 1;
+
+	for(uint8_t i = 0; i < 16; i++) {
+		if(turbo_reload[i] && (held & bit) && !--turbo_count[i]) {
+			turbo_count[i] = turbo_reload[i];
+			mask ^= bit;
+		}
+
+		bit <<= 1;
+	}
+
+	turbo_mask = mask;
+}
@@ -0,0 +1,49 @@
+/*
+* USB RetroPad Adapter - PC/PS3 USB adapter for retro-controllers!
+* Copyright (c) 2012 Bruno Freitas - bruno@brunofreitas.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TURBO_H_
+#define TURBO_H_
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/*
+ * Turbo (autofire) on Timer2.
+ *
+ * Each bit of a pad's raw button word can have its own rate, 5 to 30 Hz,
+ * stored in EEPROM per pad (0 = off). The Timer2 compare interrupt ticks at
+ * TURBO_TICK_HZ, flips the phase of the held turbo buttons that are due and
+ * keeps turbo_mask: all ones except the turbo buttons in their "released"
+ * half period. padmap_apply() ANDs the word with it through turbo_buttons(),
+ * which also restarts a turbo button in its "pressed" half period when it
+ * goes down, so every press fires at once. Timer2 only runs while the pad
+ * in use has turbo buttons.
+ */
+#define TURBO_TICK_HZ	240
+#define TURBO_MIN_HZ	5
+#define TURBO_MAX_HZ	30
+
+extern volatile uint16_t turbo_mask;
+
+void turbo_load(uint8_t pad);
+void turbo_read(uint8_t pad, uint8_t *rate);
+bool turbo_store(uint8_t pad, const uint8_t *rate);
+uint16_t turbo_buttons(uint16_t buttons);
+
+#endif /* TURBO_H_ */
@@ -119,7 +119,7 @@
  * The value is in milliamperes. [It will be divided by two since USB
  * communicates power requirements in units of 2 mA.]
  */
-#define USB_CFG_IMPLEMENT_FN_WRITE      0
+#define USB_CFG_IMPLEMENT_FN_WRITE      1
 /* Set this to 1 if you want usbFunctionWrite() to be called for control-out
  * transfers. Set it to 0 if you don't need it and want to save a couple of
  * bytes.
@@ -279,7 +279,68 @@
  * HID class is 3, no subclass and protocol required (but may be useful!)
  * CDC class is 2, use subclass 2 and protocol 1 for ACM
  */
+#ifndef USB_CFG_PLAYERS
+#define USB_CFG_PLAYERS         1
+#endif
+/* Define this to 2 to read a second NES, SNES or arcade pad on DB9 pin 4, or
+ * to 4 to also read NES Four Score and SNES multitap adapters, and describe
+ * one gamepad per player, sending their reports with report IDs 1 to 4.
+ * Player 1 has the compact report below, the other players a 5 byte report
+ * (buttons, hat switch, X and Y) so everything fits in a 254 byte report
+ * descriptor. The PS3 doesn't accept report IDs, so this is for PCs only.
+ */
+#if USB_CFG_PLAYERS != 1 && USB_CFG_PLAYERS != 2 && USB_CFG_PLAYERS != 4
+#error "USB_CFG_PLAYERS must be 1, 2 or 4"
+#endif
+#ifndef USB_CFG_EXTRA_BUTTONS
+#define USB_CFG_EXTRA_BUTTONS   0
+#endif
+/* Define this to 8, 16, 24 or 32 to read that many more bits of an arcade
+ * 74HC165 chain past the first 16 (coin, service, extra buttons) and send
+ * them as buttons 14 and up, in bytes appended to player 1's compact report.
+ */
+#if USB_CFG_EXTRA_BUTTONS % 8 || USB_CFG_EXTRA_BUTTONS > 32
+#error "USB_CFG_EXTRA_BUTTONS must be a multiple of 8, up to 32"
+#endif
+#if USB_CFG_PLAYERS > 1 || USB_CFG_EXTRA_BUTTONS
+#define USB_CFG_COMPACT_REPORT  1
+#endif
+#ifndef USB_CFG_COMPACT_REPORT
+#define USB_CFG_COMPACT_REPORT  0
+#endif
+/* Define this to 1 to describe and send a compact 8 byte report (13 buttons,
+ * hat switch, 4 axes and slider) instead of the full 20 byte PS3 layout. The
+ * compact report fits in a single low speed interrupt packet, so each report
+ * takes one host poll instead of three. PS3 pressure axes and the PS3 magic
+ * feature report are not available in this mode. The compact and multi-player
+ * descriptors declare the rumble output report, so hosts other than the PS3
+ * can send it; the full PS3 one keeps the original layout.
+ */
+#if USB_CFG_EXTRA_BUTTONS
+#define USB_CFG_EXTRA_DESCRIPTOR_LENGTH         16
+#else
+#define USB_CFG_EXTRA_DESCRIPTOR_LENGTH         0
+#endif
+#if USB_CFG_PLAYERS == 2 || (USB_CFG_PLAYERS == 4 && !USB_CFG_EXTRA_BUTTONS)
+#define USB_CFG_SETTINGS_DESCRIPTOR_LENGTH      28
+#else
+#define USB_CFG_SETTINGS_DESCRIPTOR_LENGTH      0
+#endif
+/* The settings feature reports (VS_REMAP_REPORT and on in USBVirtuaStick.h)
+ * are declared in the report descriptor when it already uses report IDs and
+ * there is room for them, which is every multi-player build except 4 players
+ * with extra buttons. Declaring them needs report IDs on every report, which
+ * the PS3 doesn't accept, so the single player builds leave them out. Only
+ * builds that declare them support the settings: tools/remap checks the
+ * descriptor for them and refuses the others.
+ */
+#if USB_CFG_PLAYERS > 1
+#define USB_CFG_HID_REPORT_DESCRIPTOR_LENGTH    (87 + 48 + 44 * (USB_CFG_PLAYERS - 2) + USB_CFG_EXTRA_DESCRIPTOR_LENGTH + USB_CFG_SETTINGS_DESCRIPTOR_LENGTH)
+#elif USB_CFG_COMPACT_REPORT
+#define USB_CFG_HID_REPORT_DESCRIPTOR_LENGTH    (91 + USB_CFG_EXTRA_DESCRIPTOR_LENGTH)
+#else
 #define USB_CFG_HID_REPORT_DESCRIPTOR_LENGTH    114
+#endif
 /* Define this to the length of the HID report descriptor, if you implement
  * an HID device. Otherwise don't define it or define it to 0.
  * If you use this define, you must add a PROGMEM character array named
@@ -24,102 +24,162 @@
 #include "NESPad.h"
 #include "GCPad_16Mhz.h"
 #include "tg16.h"
-
-// Arcade mode detection pin
-#define ARCADE_DB9_PIN	12
-
-// Extension cable detection pins
-#define DETPIN0 6  // DB9P2
-#define DETPIN1	8  // DB9P4
-#define DETPIN2	9  // DB9P6
-#define DETPIN3	10 // DB9P7
-#define DETPIN4	11 // DB9P9
-
-// Possible values (as of today) returned by the detectPad() routine
-// Normal pads
-#define PAD_ARCADE		-1
-#define PAD_GENESIS		0b00111
-#define PAD_NES 		0b00110
-#define PAD_SNES 		0b00101
-#define PAD_PS2 		0b00100
-#define PAD_GC	 		0b00011
-#define PAD_N64			0b00010
-#define PAD_NEOGEO		0b00001
-#define PAD_WIICC		0b00000
-// Extended pads (uses DB9 pin 4 and/or 2 for identification)
-#define PAD_SATURN		0b01111
-#define PAD_TG16		0b10111
-#define PAD_DFU_DONGLE	0b01110 // Reserved for USBRA DFU dongle
-
-
-// Pad directions vector
-byte pad_dir[16] = {8, 2, 6, 8, 4, 3, 5, 8, 0, 1, 7, 8, 8, 8, 8, 8};
-
-/*
- * This is the new auto-detect function (non jumper based) which detects the extension
- * cable plugged in the DB9 port. It uses grounded pins from DB9 (4, 6, 7 and 9) for
- * the detection.
- *
- *  -1 - Arcade
- * 00111 - Sega Genesis (Default)
- * 00110 - NES
- * 00101 - SNES
- * 00100 - PS2
- * 00011 - Game Cube
- * 00010 - Nintendo 64
- * 00001 - Neo Geo
- * 00000 - Reserved 1
- * 01111 - Sega Saturn
- * 10111 - TurboGrafx 16
- */
-int detectPad() {
-	int pad;
-
-	// Set pad/arcade detection pins as input, turning pull-ups on
-	pinMode(DETPIN0, INPUT);
-	digitalWrite(DETPIN0, HIGH);
-
-	pinMode(DETPIN1, INPUT);
-	digitalWrite(DETPIN1, HIGH);
-
-	pinMode(DETPIN2, INPUT);
-	digitalWrite(DETPIN2, HIGH);
-
-	pinMode(DETPIN3, INPUT);
-	digitalWrite(DETPIN3, HIGH);
-
-	pinMode(DETPIN4, INPUT);
-	digitalWrite(DETPIN4, HIGH);
-
-	pinMode(ARCADE_DB9_PIN, INPUT);
-	digitalWrite(ARCADE_DB9_PIN, HIGH);
-
-	// Check switch for Arcade position
-	if(digitalRead(ARCADE_DB9_PIN))
-		return PAD_ARCADE;
-
-	pad = (!digitalRead(DETPIN0) << 4) | (!digitalRead(DETPIN1) << 3) | (digitalRead(DETPIN2) << 2) | (digitalRead(DETPIN3) << 1) | (digitalRead(DETPIN4));
-
-	if((pad >> 3) & 0b11) {
-		switch(pad) {
-		case 0b11011:
-		case 0b10111:
-			return PAD_TG16;
-			break;
-		case 0b11111:
-		case 0b01111:
-			return PAD_SATURN;
-			break;
-		case 0b11100:
-			return PAD_PS2;
-			break;
-		default:
-			return PAD_GENESIS;
-			break;
-		}
+#include "padmap.h"
+#include "stickmap.h"
+#include "macro.h"
+#include "socd.h"
+#include "detect.h"
+#include "paddriver.h"
+
+// Hat switch values, indexed by the padmap direction nibble
+byte pad_dir[16] = {8, 0, 4, 8, 6, 7, 5, 8, 2, 1, 3, 8, 8, 8, 8, 8};
+
+// Button mapping tables, one per pad (see padmap.h)
+const PROGMEM padmap_t genesis_map[] = {
+	{ GENESIS_A, VS_SQUARE }, { GENESIS_A, VS_SQUARE_AXIS },
+	{ GENESIS_B, VS_CROSS }, { GENESIS_B, VS_CROSS_AXIS },
+	{ GENESIS_C, VS_CIRCLE }, { GENESIS_C, VS_CIRCLE_AXIS },
+	{ GENESIS_X, VS_L1 }, { GENESIS_X, VS_L1_AXIS },
+	{ GENESIS_Y, VS_TRIANGLE }, { GENESIS_Y, VS_TRIANGLE_AXIS },
+	{ GENESIS_Z, VS_R1 }, { GENESIS_Z, VS_R1_AXIS },
+	{ GENESIS_MODE, VS_SELECT },
+	{ GENESIS_START, VS_START },
+	{ GENESIS_UP | GENESIS_START, VS_PS },
+	{ 0 }
+};
+
+const PROGMEM padmap_t arcade_map[] = {
+	{ 0x10, VS_SQUARE }, { 0x10, VS_SQUARE_AXIS },
+	{ 0x20, VS_CROSS }, { 0x20, VS_CROSS_AXIS },
+	{ 0x40, VS_TRIANGLE }, { 0x40, VS_TRIANGLE_AXIS },
+	{ 0x80, VS_CIRCLE }, { 0x80, VS_CIRCLE_AXIS },
+	{ 0x100, VS_L1 }, { 0x100, VS_L1_AXIS },
+	{ 0x200, VS_R1 }, { 0x200, VS_R1_AXIS },
+	{ 0x400, VS_L2 }, { 0x400, VS_L2_AXIS },
+	{ 0x800, VS_R2 }, { 0x800, VS_R2_AXIS },
+	{ 0x1000, VS_SELECT },
+	{ 0x2000, VS_START },
+	{ 0x4000, VS_L3 },
+	{ 0x8000, VS_PS },
+	{ 0 }
+};
+
+const PROGMEM padmap_t nes_map[] = {
+	{ 2, VS_SQUARE }, { 2, VS_SQUARE_AXIS },
+	{ 1, VS_CROSS }, { 1, VS_CROSS_AXIS },
+	{ 4, VS_SELECT },
+	{ 8, VS_START },
+	{ 4 | 8, VS_PS }, // SELECT + START = PS Button
+	{ 0 }
+};
+
+const PROGMEM padmap_t snes_map[] = {
+	{ 2, VS_SQUARE }, { 2, VS_SQUARE_AXIS },
+	{ 1, VS_CROSS }, { 1, VS_CROSS_AXIS },
+	{ 256, VS_CIRCLE }, { 256, VS_CIRCLE_AXIS },
+	{ 1024, VS_L1 }, { 1024, VS_L1_AXIS },
+	{ 512, VS_TRIANGLE }, { 512, VS_TRIANGLE_AXIS },
+	{ 2048, VS_R1 }, { 2048, VS_R1_AXIS },
+	{ 4, VS_SELECT },
+	{ 8, VS_START },
+	{ 4 | 8, VS_PS }, // SELECT + START = PS Button
+	{ 0 }
+};
+
+const PROGMEM padmap_t ps2_map[] = {
+	{ PSB_SQUARE, VS_SQUARE }, { PSB_SQUARE, VS_SQUARE_AXIS },
+	{ PSB_CROSS, VS_CROSS }, { PSB_CROSS, VS_CROSS_AXIS },
+	{ PSB_CIRCLE, VS_CIRCLE }, { PSB_CIRCLE, VS_CIRCLE_AXIS },
+	{ PSB_L1, VS_L1 }, { PSB_L1, VS_L1_AXIS },
+	{ PSB_L2, VS_L2 }, { PSB_L2, VS_L2_AXIS },
+	{ PSB_TRIANGLE, VS_TRIANGLE }, { PSB_TRIANGLE, VS_TRIANGLE_AXIS },
+	{ PSB_R1, VS_R1 }, { PSB_R1, VS_R1_AXIS },
+	{ PSB_R2, VS_R2 }, { PSB_R2, VS_R2_AXIS },
+	{ PSB_L3, VS_L3 },
+	{ PSB_R3, VS_R3 },
+	{ PSB_SELECT, VS_SELECT },
+	{ PSB_START, VS_START },
+	{ PSB_SELECT | PSB_START, VS_PS }, // SELECT + START = PS Button
+	{ 0 }
+};
+
+// GC and N64 raw words are (button_data[0] << 8) | button_data[1]
+const PROGMEM padmap_t gc_map[] = {
+	{ 0x0800, VS_SQUARE }, { 0x0800, VS_SQUARE_AXIS },
+	{ 0x0200, VS_CROSS }, { 0x0200, VS_CROSS_AXIS },
+	{ 0x0400, VS_TRIANGLE }, { 0x0400, VS_TRIANGLE_AXIS },
+	{ 0x0100, VS_CIRCLE }, { 0x0100, VS_CIRCLE_AXIS },
+	{ 0x1000, VS_START },
+	{ 0x0040, VS_L1 }, { 0x0040, VS_L1_AXIS },
+	{ 0x0020, VS_R1 }, { 0x0020, VS_R1_AXIS },
+	{ 0x0010, VS_L2 }, { 0x0010, VS_L2_AXIS },
+	{ 0x1008, VS_PS }, // UP + START = PS button
+	{ 0 }
+};
+
+const PROGMEM padmap_t n64_map[] = {
+	{ 0x4000, VS_SQUARE }, { 0x4000, VS_SQUARE_AXIS },
+	{ 0x8000, VS_CROSS }, { 0x8000, VS_CROSS_AXIS },
+	{ 0x1000, VS_START },
+	{ 0x0020, VS_L1 }, { 0x0020, VS_L1_AXIS },
+	{ 0x0010, VS_R1 }, { 0x0010, VS_R1_AXIS },
+	{ 0x2000, VS_L2 }, { 0x2000, VS_L2_AXIS },
+	{ 0x1800, VS_PS }, // UP + START = PS button
+	{ 0 }
+};
+
+const PROGMEM padmap_t neogeo_map[] = {
+	{ 0x8000, VS_SQUARE }, { 0x8000, VS_SQUARE_AXIS },
+	{ 0x01, VS_CROSS }, { 0x01, VS_CROSS_AXIS },
+	{ 0x400, VS_CIRCLE }, { 0x400, VS_CIRCLE_AXIS },
+	{ 0x200, VS_TRIANGLE }, { 0x200, VS_TRIANGLE_AXIS }, // D button is also 0x2000
+	{ 0x100, VS_SELECT },
+	{ 0x4000, VS_START },
+	{ 0x100 | 0x4000, VS_PS }, // SELECT + START = PS Button
+	{ 0 }
+};
+
+const PROGMEM padmap_t saturn_map[] = {
+	{ SATURN_A, VS_SQUARE }, { SATURN_A, VS_SQUARE_AXIS },
+	{ SATURN_B, VS_CROSS }, { SATURN_B, VS_CROSS_AXIS },
+	{ SATURN_C, VS_CIRCLE }, { SATURN_C, VS_CIRCLE_AXIS },
+	{ SATURN_X, VS_L1 }, { SATURN_X, VS_L1_AXIS },
+	{ SATURN_Y, VS_TRIANGLE }, { SATURN_Y, VS_TRIANGLE_AXIS },
+	{ SATURN_Z, VS_R1 }, { SATURN_Z, VS_R1_AXIS },
+	{ SATURN_L, VS_L2 }, { SATURN_L, VS_L2_AXIS },
+	{ SATURN_R, VS_R2 }, { SATURN_R, VS_R2_AXIS },
+	{ SATURN_START, VS_START },
+	{ SATURN_UP | SATURN_START, VS_PS },
+	{ 0 }
+};
+
+const PROGMEM padmap_t tg16_map[] = {
+	{ 1 << TG16_II, VS_SQUARE }, { 1 << TG16_II, VS_SQUARE_AXIS },
+	{ 1 << TG16_I, VS_CROSS }, { 1 << TG16_I, VS_CROSS_AXIS },
+	{ 1 << TG16_RUN, VS_START },
+	{ 1 << TG16_SELECT, VS_SELECT },
+	{ (1 << TG16_RUN) | (1 << TG16_SELECT), VS_PS },
+	{ 0 }
+};
+
+// Digital directions to stick axes, LEFT and UP win over RIGHT and DOWN
+// when socd_resolve() lets opposing directions through
+void dir_to_axes(byte dir, uint8_t *x, uint8_t *y) {
+	if(dir & PADMAP_LEFT) {
+		*x = 0x00;
+	} else if (dir & PADMAP_RIGHT) {
+		*x = 0xFF;
+	} else {
+		*x = 0x80;
 	}
 
-	return (pad & 0b111);
+	if(dir & PADMAP_UP) {
+		*y = 0x00;
+	} else if (dir & PADMAP_DOWN) {
+		*y = 0xFF;
+	} else {
+		*y = 0x80;
+	}
 }
 
 void setup() {
@@ -127,602 +187,356 @@ void setup() {
 	vs_init(true);
 }
 
-void genesis_loop() {
-	int button_data;
-
-	genesis_init();
-
-	for (;;) {
-		vs_reset_watchdog();
-
-		button_data = genesis_read();
-
-		gamepad_state.l_x_axis = 0x80;
-		gamepad_state.l_y_axis = 0x80;
-
-		if(button_data & GENESIS_LEFT) {
-			gamepad_state.l_x_axis = 0x00;
-		} else if (button_data & GENESIS_RIGHT) {
-			gamepad_state.l_x_axis = 0xFF;
-		}
-
-		if(button_data & GENESIS_UP) {
-			gamepad_state.l_y_axis = 0x00;
-		} else if (button_data & GENESIS_DOWN) {
-			gamepad_state.l_y_axis = 0xFF;
-		}
-
-		gamepad_state.square_btn = (button_data & GENESIS_A) > 0;
-		gamepad_state.square_axis = (gamepad_state.square_btn ? 0xFF : 0x00);
-
-		gamepad_state.cross_btn = (button_data & GENESIS_B) > 0;
-		gamepad_state.cross_axis = (gamepad_state.cross_btn ? 0xFF : 0x00);
-
-		gamepad_state.circle_btn = (button_data & GENESIS_C) > 0;
-		gamepad_state.circle_axis = (gamepad_state.circle_btn ? 0xFF : 0x00);
-
-		gamepad_state.l1_btn = (button_data & GENESIS_X) > 0;
-		gamepad_state.l1_axis = (gamepad_state.l1_btn ? 0xFF : 0x00);
-
-		gamepad_state.triangle_btn = (button_data & GENESIS_Y) > 0;
-		gamepad_state.triangle_axis = (gamepad_state.triangle_btn ? 0xFF : 0x00);
+// Loop of the digital pads, one instance per driver (see paddriver.h)
+template <class Pad>
+void digital_loop(const padmap_t *map) {
+	typename Pad::state_t button_data, held = ~0;
+	uint8_t n;
 
-		gamepad_state.r1_btn = (button_data & GENESIS_Z) > 0;
-		gamepad_state.r1_axis = (gamepad_state.r1_btn ? 0xFF : 0x00);
+	padmap_load(Pad::padmap);
 
-		gamepad_state.select_btn = (button_data & GENESIS_MODE) > 0;
+	Pad::init();
 
-		gamepad_state.start_btn = (button_data & GENESIS_START) > 0;
-
-		gamepad_state.ps_btn = (button_data & GENESIS_UP) && (button_data & GENESIS_START);
-
-		vs_send_pad_state();
-	}
-}
-
-void arcade_loop() {
-	int button_data;
-
-	NESPad::init(6, 7, 13);
+	if(Pad::caps & PAD_CAP_MACRO)
+		macro_init(0x2000 | 0x8000); // START + HOME
 
 	for (;;) {
 		vs_reset_watchdog();
 
-		button_data = NESPad::read(16);
-
-		gamepad_state.l_x_axis = 0x80;
-		gamepad_state.l_y_axis = 0x80;
-
-		if(button_data & 0x01) {
-			gamepad_state.l_y_axis = 0x00;
-		} else if (button_data & 0x02) {
-			gamepad_state.l_y_axis = 0xFF;
-		}
-
-
-		if(button_data & 0x04) {
-			gamepad_state.l_x_axis = 0x00;
-		} else if (button_data & 0x08) {
-			gamepad_state.l_x_axis = 0xFF;
-		}
-
-		gamepad_state.square_btn = (button_data & 0x10) > 0;
-		gamepad_state.square_axis = (gamepad_state.square_btn ? 0xFF : 0x00);
-
-		gamepad_state.cross_btn = (button_data & 0x20) > 0;
-		gamepad_state.cross_axis = (gamepad_state.cross_btn ? 0xFF : 0x00);
-
-		gamepad_state.triangle_btn = (button_data & 0x40) > 0;
-		gamepad_state.triangle_axis = (gamepad_state.triangle_btn ? 0xFF : 0x00);
-
-		gamepad_state.circle_btn = (button_data & 0x80) > 0;
-		gamepad_state.circle_axis = (gamepad_state.circle_btn ? 0xFF : 0x00);
-
-		gamepad_state.l1_btn = (button_data & 0x100) > 0;
-		gamepad_state.l1_axis = (gamepad_state.l1_btn ? 0xFF : 0x00);
-
-		gamepad_state.r1_btn = (button_data & 0x200) > 0;
-		gamepad_state.r1_axis = (gamepad_state.r1_btn ? 0xFF : 0x00);
-
-		gamepad_state.l2_btn = (button_data & 0x400) > 0;
-		gamepad_state.l2_axis = (gamepad_state.l2_btn ? 0xFF : 0x00);
-
-		gamepad_state.r2_btn = (button_data & 0x800) > 0;
-		gamepad_state.r2_axis = (gamepad_state.r2_btn ? 0xFF : 0x00);
-
-		gamepad_state.select_btn = (button_data & 0x1000) > 0;
+		// Checked before the read, with the last pass's buttons: right after
+		// a read, a Genesis 6-button pad's counter hasn't reset yet
+		if(detect_changed(held == 0 && Pad::quiet()))
+			return;
 
-		gamepad_state.start_btn = (button_data & 0x2000) > 0;
+		if((Pad::caps & PAD_CAP_MACRO) && macro_synced())
+			vs_wait_report();
 
-		gamepad_state.l3_btn = (button_data & 0x4000) > 0;
+		button_data = Pad::poll();
 
-		gamepad_state.ps_btn = (button_data & 0x8000) > 0;
+		if((Pad::caps & PAD_CAP_MACRO) && macro_engaged(button_data))
+			button_data = macro_frame(button_data);
 
-		vs_send_pad_state();
-	}
-}
+		dir_to_axes(socd_resolve(padmap_dir(button_data, Pad::up, Pad::down, Pad::left, Pad::right)),
+				&gamepad_state.l_x_axis, &gamepad_state.l_y_axis);
 
-void nes_loop() {
-	int button_data;
+		padmap_apply(map, button_data, (uint8_t *) &gamepad_state);
 
-	NESPad::init(5, 6, 7);
+#if USB_CFG_EXTRA_BUTTONS
+		if(Pad::extra_bytes)
+			memcpy((uint8_t *) &gamepad_state + VS_EXTRA_BUTTONS, Pad::poll_extra(), Pad::extra_bytes);
+#endif
 
-	for (;;) {
-		vs_reset_watchdog();
+		held = button_data;
 
-		button_data = NESPad::read(8);
+		// Players 2 and up come from the same poll; both bounds are
+		// constants, so single player pads and builds drop the loop
+		for (n = 1; n < Pad::players && n < VS_PLAYERS; n++) {
+			typename Pad::state_t b = Pad::poll_player(n);
+			gamepad_state_t *state = vs_player_state(n);
 
-		gamepad_state.l_x_axis = 0x80;
-		gamepad_state.l_y_axis = 0x80;
+			dir_to_axes(socd_resolve(padmap_dir(b, Pad::up, Pad::down, Pad::left, Pad::right), n),
+					&state->l_x_axis, &state->l_y_axis);
 
-		if(button_data & 64) {
-			gamepad_state.l_x_axis = 0x00;
-		} else if (button_data & 128) {
-			gamepad_state.l_x_axis = 0xFF;
-		}
+			padmap_apply(map, b, (uint8_t *) state);
 
-		if(button_data & 16) {
-			gamepad_state.l_y_axis = 0x00;
-		} else if (button_data & 32) {
-			gamepad_state.l_y_axis = 0xFF;
+			// The other pads' data lines are detection pins too
+			held |= b;
 		}
 
-		gamepad_state.square_btn = (button_data & 2) > 0;
-		gamepad_state.square_axis = (gamepad_state.square_btn ? 0xFF : 0x00);
-
-		gamepad_state.cross_btn = (button_data & 1) > 0;
-		gamepad_state.cross_axis = (gamepad_state.cross_btn ? 0xFF : 0x00);
-
-		gamepad_state.select_btn = (button_data & 4) > 0;
-
-		gamepad_state.start_btn = (button_data & 8) > 0;
-
-		gamepad_state.ps_btn = (button_data & 4) && (button_data & 8); // SELECT + START = PS Button
-
 		vs_send_pad_state();
 	}
 }
 
-void snes_loop() {
-	int button_data;
-
-	NESPad::init(5, 6, 7);
-
-	for (;;) {
-		vs_reset_watchdog();
-
-		button_data = NESPad::read(16);
-
-		gamepad_state.l_x_axis = 0x80;
-		gamepad_state.l_y_axis = 0x80;
-
-		if(button_data & 64) {
-			gamepad_state.l_x_axis = 0x00;
-		} else if (button_data & 128) {
-			gamepad_state.l_x_axis = 0xFF;
-		}
-
-		if(button_data & 16) {
-			gamepad_state.l_y_axis = 0x00;
-		} else if (button_data & 32) {
-			gamepad_state.l_y_axis = 0xFF;
-		}
-
-		gamepad_state.square_btn = (button_data & 2) > 0;
-		gamepad_state.square_axis = (gamepad_state.square_btn ? 0xFF : 0x00);
+// Pressure byte (PSAB_*) of each raw PS2 button bit, 0 if it has none
+const PROGMEM uint8_t ps2_pressure[16] = {
+	0, 0, 0, 0, PSAB_PAD_UP, PSAB_PAD_RIGHT, PSAB_PAD_DOWN, PSAB_PAD_LEFT,
+	PSAB_L2, PSAB_R2, PSAB_L1, PSAB_R1, PSAB_TRIANGLE, PSAB_CIRCLE, PSAB_CROSS, PSAB_SQUARE
+};
 
-		gamepad_state.cross_btn = (button_data & 1) > 0;
-		gamepad_state.cross_axis = (gamepad_state.cross_btn ? 0xFF : 0x00);
+// Replaces the full scale value padmap_apply() gave a pressed button's axis
+// with the pressure of the raw button remapped onto it, if that one has any.
+// Axes of buttons up or held off by turbo stay zero.
+static void ps2_pressure_axis(uint8_t *axis, uint8_t bit) {
+	uint8_t source;
 
-		gamepad_state.circle_btn = (button_data & 256) > 0;
-		gamepad_state.circle_axis = (gamepad_state.circle_btn ? 0xFF : 0x00);
+	if(!*axis)
+		return;
 
-		gamepad_state.l1_btn = (button_data & 1024) > 0;
-		gamepad_state.l1_axis = (gamepad_state.l1_btn ? 0xFF : 0x00);
+	source = pgm_read_byte(&ps2_pressure[padmap_source(bit)]);
 
-		gamepad_state.triangle_btn = (button_data & 512) > 0;
-		gamepad_state.triangle_axis = (gamepad_state.triangle_btn ? 0xFF : 0x00);
-
-		gamepad_state.r1_btn = (button_data & 2048) > 0;
-		gamepad_state.r1_axis = (gamepad_state.r1_btn ? 0xFF : 0x00);
-
-		gamepad_state.select_btn = (button_data & 4) > 0;
-
-		gamepad_state.start_btn = (button_data & 8) > 0;
-
-		gamepad_state.ps_btn = (button_data & 4) && (button_data & 8); // SELECT + START = PS Button
-
-		vs_send_pad_state();
-	}
+	if(source)
+		*axis = PS2Pad::pressure(source);
 }
 
 void ps2_loop() {
+	word button_data;
 	byte dir = 0;
+	uint8_t small, large;
 
 	while (PS2Pad::init(true)) {
 		vs_reset_watchdog();
 		delayMicroseconds(10000); // 10ms delay
 		vs_send_pad_state();
+
+		if(detect_changed(true))
+			return;
 	}
 
+	stickmap_init(STICKMAP_PS2);
+
 	for (;;) {
 		vs_reset_watchdog();
 
+		if(vs_get_rumble(&small, &large))
+			PS2Pad::rumble(small, large);
+
 		PS2Pad::read();
 
+		button_data = PS2Pad::psx_buttons();
+
+		dir = socd_resolve(padmap_dir(button_data, PSB_PAD_UP, PSB_PAD_DOWN, PSB_PAD_LEFT, PSB_PAD_RIGHT));
+
 		if(PS2Pad::type() == 0) {
 			gamepad_state.r_x_axis = 0x80;
 			gamepad_state.r_y_axis = 0x80;
 
-			if(PS2Pad::button(PSB_PAD_LEFT)) {
-				gamepad_state.l_x_axis = 0x00;
-			} else if (PS2Pad::button(PSB_PAD_RIGHT)) {
-				gamepad_state.l_x_axis = 0xFF;
-			} else {
-				gamepad_state.l_x_axis = 0x80;
-			}
-
-			if(PS2Pad::button(PSB_PAD_UP)) {
-				gamepad_state.l_y_axis = 0x00;
-			} else if (PS2Pad::button(PSB_PAD_DOWN)) {
-				gamepad_state.l_y_axis = 0xFF;
-			} else {
-				gamepad_state.l_y_axis = 0x80;
-			}
-
+			dir_to_axes(dir, &gamepad_state.l_x_axis, &gamepad_state.l_y_axis);
 		} else {
 			gamepad_state.l_x_axis = PS2Pad::stick(PSS_LX);
 			gamepad_state.l_y_axis = PS2Pad::stick(PSS_LY);
 			gamepad_state.r_x_axis = PS2Pad::stick(PSS_RX);
 			gamepad_state.r_y_axis = PS2Pad::stick(PSS_RY);
 
-			dir = PS2Pad::button(PSB_PAD_UP) << 3 | PS2Pad::button(PSB_PAD_DOWN) << 2 | PS2Pad::button(PSB_PAD_LEFT) << 1 | PS2Pad::button(PSB_PAD_RIGHT);
+			stickmap_apply(STICKMAP_LEFT, &gamepad_state.l_x_axis, &gamepad_state.l_y_axis);
+			stickmap_apply(STICKMAP_RIGHT, &gamepad_state.r_x_axis, &gamepad_state.r_y_axis);
 
 			gamepad_state.direction = pad_dir[dir];
 		}
 
-		gamepad_state.square_btn = PS2Pad::button(PSB_SQUARE);
-		gamepad_state.square_axis = (gamepad_state.square_btn ? 0xFF : 0x00);
-
-		gamepad_state.cross_btn = PS2Pad::button(PSB_CROSS);
-		gamepad_state.cross_axis = (gamepad_state.cross_btn ? 0xFF : 0x00);
-
-		gamepad_state.circle_btn = PS2Pad::button(PSB_CIRCLE);
-		gamepad_state.circle_axis = (gamepad_state.circle_btn ? 0xFF : 0x00);
-
-		gamepad_state.l1_btn =PS2Pad::button(PSB_L1);
-		gamepad_state.l1_axis = (gamepad_state.l1_btn ? 0xFF : 0x00);
-
-		gamepad_state.l2_btn =PS2Pad::button(PSB_L2);
-		gamepad_state.l2_axis = (gamepad_state.l2_btn ? 0xFF : 0x00);
-
-		gamepad_state.triangle_btn = PS2Pad::button(PSB_TRIANGLE);
-		gamepad_state.triangle_axis = (gamepad_state.triangle_btn ? 0xFF : 0x00);
-
-		gamepad_state.r1_btn = PS2Pad::button(PSB_R1);
-		gamepad_state.r1_axis = (gamepad_state.r1_btn ? 0xFF : 0x00);
-
-		gamepad_state.r2_btn = PS2Pad::button(PSB_R2);
-		gamepad_state.r2_axis = (gamepad_state.r2_btn ? 0xFF : 0x00);
-
-		gamepad_state.l3_btn = PS2Pad::button(PSB_L3);
-
-		gamepad_state.r3_btn = PS2Pad::button(PSB_R3);
-
-		gamepad_state.select_btn = PS2Pad::button(PSB_SELECT);
-
-		gamepad_state.start_btn = PS2Pad::button(PSB_START);
-
-		gamepad_state.ps_btn = PS2Pad::button(PSB_SELECT) && PS2Pad::button(PSB_START); // SELECT + START = PS Button
+		padmap_apply(ps2_map, button_data, (uint8_t *) &gamepad_state);
+
+		// Bit numbers of PSB_TRIANGLE and on
+		if(PS2Pad::pressures()) {
+			ps2_pressure_axis(&gamepad_state.triangle_axis, 12);
+			ps2_pressure_axis(&gamepad_state.circle_axis, 13);
+			ps2_pressure_axis(&gamepad_state.cross_axis, 14);
+			ps2_pressure_axis(&gamepad_state.square_axis, 15);
+			ps2_pressure_axis(&gamepad_state.l1_axis, 10);
+			ps2_pressure_axis(&gamepad_state.r1_axis, 11);
+			ps2_pressure_axis(&gamepad_state.l2_axis, 8);
+			ps2_pressure_axis(&gamepad_state.r2_axis, 9);
+		}
 
 		vs_send_pad_state();
+
+		if(detect_changed(button_data == 0 && PS2Pad::bus_idle() &&
+				detect_stick_idle(gamepad_state.l_x_axis, gamepad_state.l_y_axis) &&
+				detect_stick_idle(gamepad_state.r_x_axis, gamepad_state.r_y_axis)))
+			return;
 	}
 }
 
 void gc_loop() {
 	byte *button_data;
-	byte dir = 0;
+	word buttons;
+	bool lost = false;
 
 	while(GCPad_init() == 0) {
 		vs_reset_watchdog();
 		delayMicroseconds(10000); // 10ms delay
 		vs_send_pad_state();
+
+		if(detect_changed(true))
+			return;
 	}
 
-	for(;;) {
-		vs_reset_watchdog();
+	// Take the stick origins right after a host poll, like the reads below
+	vs_wait_poll();
+	GCPad_origin();
 
-		button_data = GCPad_read();
+	stickmap_init(STICKMAP_GC);
 
-		dir = ((button_data[1] & 0x08) > 0) << 3 | ((button_data[1] & 0x04) > 0) << 2 | ((button_data[1] & 0x01) > 0) << 1 | ((button_data[1] & 0x02) > 0);
+	for(;;) {
+		vs_reset_watchdog();
 
-		gamepad_state.direction = pad_dir[dir];
+		// Talk to the pad right after the host fetched our last packet, so
+		// never during an interrupt poll (see vs_wait_poll())
+		vs_wait_poll();
 
-		gamepad_state.square_btn = (button_data[0] & 0x08) > 0;
-		gamepad_state.square_axis = (gamepad_state.square_btn ? 0xFF : 0x00);
+		button_data = GCPad_read();
 
-		gamepad_state.cross_btn = (button_data[0] & 0x02) > 0;
-		gamepad_state.cross_axis = (gamepad_state.cross_btn ? 0xFF : 0x00);
+		// No reply: the pad was pulled. Release its buttons and check the
+		// cable straight away. A pad answering again may be another one, so
+		// the driver restarts to take its origins.
+		if(!button_data) {
+			lost = true;
+			vs_reset_pad_status();
+			vs_send_pad_state();
 
-		gamepad_state.triangle_btn = (button_data[0] & 0x04) > 0;
-		gamepad_state.triangle_axis = (gamepad_state.triangle_btn ? 0xFF : 0x00);
+			if(detect_changed(true))
+				return;
 
-		gamepad_state.circle_btn = (button_data[0] & 0x01) > 0;
-		gamepad_state.circle_axis = (gamepad_state.circle_btn ? 0xFF : 0x00);
+			continue;
+		}
 
-		gamepad_state.start_btn = (button_data[0] & 0x10) > 0;
+		if(lost)
+			return;
 
-		gamepad_state.l1_btn = (button_data[1] & 0x40) > 0;
-		gamepad_state.l1_axis = (gamepad_state.l1_btn ? 0xFF : 0x00);
+		buttons = (button_data[0] << 8) | button_data[1];
 
-		gamepad_state.r1_btn = (button_data[1] & 0x20) > 0;
-		gamepad_state.r1_axis = (gamepad_state.r1_btn ? 0xFF : 0x00);
+		gamepad_state.direction = pad_dir[socd_resolve(padmap_dir(buttons, 0x0008, 0x0004, 0x0001, 0x0002))];
 
-		gamepad_state.l2_btn = (button_data[1] & 0x10) > 0;
-		gamepad_state.l2_axis = (gamepad_state.l2_btn ? 0xFF : 0x00);
+		padmap_apply(gc_map, buttons, (uint8_t *) &gamepad_state);
 
-		gamepad_state.ps_btn = (button_data[1] & 0x08) && (button_data[0] & 0x10); // UP + START = PS button
+		gamepad_state.l_x_axis = GCPad_axis(GC_STICK_X, false);
+		gamepad_state.l_y_axis = GCPad_axis(GC_STICK_Y, true);
+		gamepad_state.r_x_axis = GCPad_axis(GC_C_X, false);
+		gamepad_state.r_y_axis = GCPad_axis(GC_C_Y, true);
 
-		gamepad_state.l_x_axis = map(button_data[2], 32, 223, 0, 255);
-		gamepad_state.l_y_axis = map((byte)~button_data[3], 32, 223, 0, 255);
-		gamepad_state.r_x_axis = map(button_data[4], 32, 223, 0, 255);
-		gamepad_state.r_y_axis = map((byte)~button_data[5], 32, 223, 0, 255);
+		stickmap_apply(STICKMAP_LEFT, &gamepad_state.l_x_axis, &gamepad_state.l_y_axis);
+		stickmap_apply(STICKMAP_RIGHT, &gamepad_state.r_x_axis, &gamepad_state.r_y_axis);
 
 		gamepad_state.slider = 0x80 - (button_data[6] >> 1) + (button_data[7] >> 1);
 
 		vs_send_pad_state();
 
-		delayMicroseconds(5000);
+		if(detect_changed(!(buttons & GC_BUTTONS) &&
+				detect_stick_idle(gamepad_state.l_x_axis, gamepad_state.l_y_axis) &&
+				detect_stick_idle(gamepad_state.r_x_axis, gamepad_state.r_y_axis) &&
+				detect_stick_idle(gamepad_state.slider, 0x80)))
+			return;
 	}
 }
 
 void n64_loop() {
 	byte *button_data;
-	byte dir = 0;
+	word buttons;
+	uint8_t small, large;
+	bool lost = false;
 
 	while(GCPad_init() == 0) {
 		vs_reset_watchdog();
 		delayMicroseconds(10000); // 10ms delay
 		vs_send_pad_state();
-	}
-
-	for(;;) {
-		vs_reset_watchdog();
-
-		button_data = N64Pad_read();
-
-		dir = ((button_data[0] & 0x08) > 0) << 3 | ((button_data[0] & 0x04) > 0) << 2 | ((button_data[0] & 0x02) > 0) << 1 | ((button_data[0] & 0x01) > 0);
 
-		gamepad_state.direction = pad_dir[dir];
-
-		gamepad_state.square_btn = (button_data[0] & 0x40) > 0;
-		gamepad_state.square_axis = (gamepad_state.square_btn ? 0xFF : 0x00);
-
-		gamepad_state.cross_btn = (button_data[0] & 0x80) > 0;
-		gamepad_state.cross_axis = (gamepad_state.cross_btn ? 0xFF : 0x00);
-
-		gamepad_state.start_btn = (button_data[0] & 0x10) > 0;
-
-		gamepad_state.l1_btn = (button_data[1] & 0x20) > 0;
-		gamepad_state.l1_axis = (gamepad_state.l1_btn ? 0xFF : 0x00);
-
-		gamepad_state.r1_btn = (button_data[1] & 0x10) > 0;
-		gamepad_state.r1_axis = (gamepad_state.r1_btn ? 0xFF : 0x00);
-
-		gamepad_state.l2_btn = (button_data[0] & 0x20) > 0;
-		gamepad_state.l2_axis = (gamepad_state.l2_btn ? 0xFF : 0x00);
-
-		gamepad_state.ps_btn = (button_data[0] & 0x08) && (button_data[0] & 0x10);  // UP + START = PS button
-
-		gamepad_state.l_x_axis = ((button_data[2] >= 128) ? button_data[2] - 128 : button_data[2] + 128);
-		gamepad_state.l_y_axis = ~((button_data[3] >= 128) ? button_data[3] - 128 : button_data[3] + 128);
-
-		// Fix analog logical data since N64 pad doesn't use the full range
-		gamepad_state.l_x_axis = map(gamepad_state.l_x_axis, 32, 223, 0, 255);
-		gamepad_state.l_y_axis = map(gamepad_state.l_y_axis, 32, 223, 0, 255);
-
-		gamepad_state.r_x_axis = 0x80;
-		gamepad_state.r_y_axis = 0x80;
-
-		if(button_data[1] & 0x08) { // C Up
-			gamepad_state.r_y_axis = 0x00;
-		} else if(button_data[1] & 0x04) { // C Down
-			gamepad_state.r_y_axis = 0xFF;
-		}
-
-		if(button_data[1] & 0x02) { // C Left
-			gamepad_state.r_x_axis = 0x00;;
-		} else if(button_data[1] & 0x01) { // C Right
-			gamepad_state.r_x_axis = 0xFF;
-		}
-
-		vs_send_pad_state();
+		if(detect_changed(true))
+			return;
 	}
-}
 
-void neogeo_loop() {
-	int button_data;
+	stickmap_init(STICKMAP_N64);
 
-	NESPad::init(5, 6, 7);
-
-	for (;;) {
+	for(;;) {
 		vs_reset_watchdog();
 
-		button_data = NESPad::read(16);
-
-		gamepad_state.l_x_axis = 0x80;
-		gamepad_state.l_y_axis = 0x80;
-
-		if(button_data & 0x02) {
-			gamepad_state.l_x_axis = 0x00; // LEFT
-		} else if (button_data & 0x800) {
-			gamepad_state.l_x_axis = 0xFF; // RIGHT
-		}
-
-		if(button_data & 0x04) {
-			gamepad_state.l_y_axis = 0x00; // UP
-		} else if (button_data & 0x1000) {
-			gamepad_state.l_y_axis = 0xFF; // DOWN
-		}
-
-		gamepad_state.square_btn = (button_data & 0x8000) > 0;
-		gamepad_state.square_axis = (gamepad_state.square_btn ? 0xFF : 0x00);
-
-		gamepad_state.cross_btn = (button_data & 0x01) > 0;
-		gamepad_state.cross_axis = (gamepad_state.cross_btn ? 0xFF : 0x00);
-
-		gamepad_state.circle_btn = (button_data & 0x400) > 0;
-		gamepad_state.circle_axis = (gamepad_state.circle_btn ? 0xFF : 0x00);
-
-		gamepad_state.triangle_btn = (button_data & 0x200) > 0; // D button is also 0x2000
-		gamepad_state.triangle_axis = (gamepad_state.triangle_btn ? 0xFF : 0x00);
-
-		gamepad_state.select_btn = (button_data & 0x100) > 0;
-
-		gamepad_state.start_btn = (button_data & 0x4000) > 0;
-
-		gamepad_state.ps_btn = (button_data & 0x100) && (button_data & 0x4000); // SELECT + START = PS Button
-
-		vs_send_pad_state();
-	}
-}
+		// Talk to the pad right after the host fetched our last packet, so
+		// never during an interrupt poll (see vs_wait_poll())
+		vs_wait_poll();
 
-void saturn_loop() {
-	int button_data;
-
-	saturn_init();
-
-	for (;;) {
-		vs_reset_watchdog();
+		button_data = N64Pad_read();
 
-		button_data = saturn_read();
+		// No reply: the pad was pulled. Release its buttons and check the
+		// cable straight away. A pad answering again may be another one, so
+		// the driver restarts to probe its pak.
+		if(!button_data) {
+			lost = true;
+			vs_reset_pad_status();
+			vs_send_pad_state();
 
-		gamepad_state.l_x_axis = 0x80;
-		gamepad_state.l_y_axis = 0x80;
+			if(detect_changed(true))
+				return;
 
-		if(button_data & SATURN_LEFT) {
-			gamepad_state.l_x_axis = 0x00;
-		} else if (button_data & SATURN_RIGHT) {
-			gamepad_state.l_x_axis = 0xFF;
+			continue;
 		}
 
-		if(button_data & SATURN_UP) {
-			gamepad_state.l_y_axis = 0x00;
-		} else if (button_data & SATURN_DOWN) {
-			gamepad_state.l_y_axis = 0xFF;
-		}
+		if(lost)
+			return;
 
-		gamepad_state.square_btn = (button_data & SATURN_A) > 0;
-		gamepad_state.square_axis = (gamepad_state.square_btn ? 0xFF : 0x00);
+		N64Pad_pak_task();
 
-		gamepad_state.cross_btn = (button_data & SATURN_B) > 0;
-		gamepad_state.cross_axis = (gamepad_state.cross_btn ? 0xFF : 0x00);
+		if(vs_get_rumble(&small, &large))
+			N64Pad_rumble(small || large);
 
-		gamepad_state.circle_btn = (button_data & SATURN_C) > 0;
-		gamepad_state.circle_axis = (gamepad_state.circle_btn ? 0xFF : 0x00);
+		buttons = (button_data[0] << 8) | button_data[1];
 
-		gamepad_state.l1_btn = (button_data & SATURN_X) > 0;
-		gamepad_state.l1_axis = (gamepad_state.l1_btn ? 0xFF : 0x00);
+		gamepad_state.direction = pad_dir[socd_resolve(padmap_dir(buttons, 0x0800, 0x0400, 0x0200, 0x0100))];
 
-		gamepad_state.triangle_btn = (button_data & SATURN_Y) > 0;
-		gamepad_state.triangle_axis = (gamepad_state.triangle_btn ? 0xFF : 0x00);
+		padmap_apply(n64_map, buttons, (uint8_t *) &gamepad_state);
 
-		gamepad_state.r1_btn = (button_data & SATURN_Z) > 0;
-		gamepad_state.r1_axis = (gamepad_state.r1_btn ? 0xFF : 0x00);
+		// N64 pad doesn't use the full range, N64Pad_axis() stretches it
+		gamepad_state.l_x_axis = N64Pad_axis(N64_STICK_X, false);
+		gamepad_state.l_y_axis = N64Pad_axis(N64_STICK_Y, true);
 
-		gamepad_state.l2_btn = (button_data & SATURN_L) > 0;
-		gamepad_state.l2_axis = (gamepad_state.l2_btn ? 0xFF : 0x00);
+		stickmap_apply(STICKMAP_LEFT, &gamepad_state.l_x_axis, &gamepad_state.l_y_axis);
 
-		gamepad_state.r2_btn = (button_data & SATURN_R) > 0;
-		gamepad_state.r2_axis = (gamepad_state.r2_btn ? 0xFF : 0x00);
+		// C buttons
+		dir_to_axes(padmap_dir(buttons, 0x0008, 0x0004, 0x0002, 0x0001),
+				&gamepad_state.r_x_axis, &gamepad_state.r_y_axis);
 
-		gamepad_state.start_btn = (button_data & SATURN_START) > 0;
-
-		gamepad_state.ps_btn = (button_data & SATURN_UP) && (button_data & SATURN_START);
+		// A pak block transfer is due on the next pass: queue a report even
+		// if nothing changed, so that vs_wait_poll() returns right after the
+		// host fetched it and not at once
+		if(N64Pad_pak_due())
+			vs_wait_report();
 
 		vs_send_pad_state();
+
+		if(detect_changed(!(buttons & N64_BUTTONS) &&
+				detect_stick_idle(gamepad_state.l_x_axis, gamepad_state.l_y_axis)))
+			return;
 	}
 }
 
-void tg16_loop(void) {
-	int button_data;
-
-	tg16_init();
-
-	for (;;) {
+void unsupported_pad(void) {
+	for(;;) {
 		vs_reset_watchdog();
-
-		button_data = tg16_read();
-
-		gamepad_state.l_x_axis = 0x80;
-		gamepad_state.l_y_axis = 0x80;
-
-		if(button_data & (1 << TG16_LEFT)) {
-			gamepad_state.l_x_axis = 0x00;
-		} else if (button_data & (1 << TG16_RIGHT)) {
-			gamepad_state.l_x_axis = 0xFF;
-		}
-
-		if(button_data & (1 << TG16_UP)) {
-			gamepad_state.l_y_axis = 0x00;
-		} else if (button_data & (1 << TG16_DOWN)) {
-			gamepad_state.l_y_axis = 0xFF;
-		}
-
-		gamepad_state.square_btn = (button_data & (1 << TG16_II)) > 0;
-		gamepad_state.square_axis = (gamepad_state.square_btn ? 0xFF : 0x00);
-
-		gamepad_state.cross_btn = (button_data & (1 << TG16_I)) > 0;
-		gamepad_state.cross_axis = (gamepad_state.cross_btn ? 0xFF : 0x00);
-
-		gamepad_state.start_btn = (button_data & (1 << TG16_RUN)) > 0;
-
-		gamepad_state.select_btn = (button_data & (1 << TG16_SELECT)) > 0;
-
-		gamepad_state.ps_btn = gamepad_state.start_btn && gamepad_state.select_btn;
-
 		vs_send_pad_state();
-	}
-}
 
-void unsupported_pad(void) {
-	for(;;);
+		if(detect_changed(true))
+			return;
+	}
 }
 
+// Runs the driver of the pad plugged in, and again whenever its loop returns
+// because the cable changed (see detect.h)
 void loop() {
+	vs_reset_pad_status();
+
 	switch (detectPad()) {
 	case PAD_ARCADE:
-		arcade_loop();
+		digital_loop<ArcadeDriver>(arcade_map);
 		break;
 	case PAD_NES:
-		nes_loop();
+		digital_loop<NESDriver>(nes_map);
 		break;
 	case PAD_SNES:
-		snes_loop();
+		digital_loop<SNESDriver>(snes_map);
 		break;
 	case PAD_PS2:
+		padmap_load(PADMAP_PS2);
 		ps2_loop();
 		break;
 	case PAD_GC:
+		padmap_load(PADMAP_GC);
 		gc_loop();
 		break;
 	case PAD_N64:
+		padmap_load(PADMAP_N64);
 		n64_loop();
 		break;
 	case PAD_NEOGEO:
-		neogeo_loop();
+		digital_loop<NeoGeoDriver>(neogeo_map);
 		break;
 	case PAD_SATURN:
-		saturn_loop();
+		digital_loop<SaturnDriver>(saturn_map);
 		break;
 	case PAD_TG16:
-		tg16_loop();
+		digital_loop<TG16Driver>(tg16_map);
 		break;
 	case PAD_WIICC:
 		unsupported_pad();
 		break;
 	default:
-		genesis_loop();
+		digital_loop<GenesisDriver>(genesis_map);
 		break;
 	}
 }
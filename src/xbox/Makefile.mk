@@ -85,7 +85,7 @@ SRC = usbdrv/usbdrv.c usbdrv/oddebug.c
 
 # List C++ source files here. (C dependencies are automatically generated.)
 CPPSRC = ../main.cpp usbra.cpp XBOXPad.cpp ../genesis.cpp ../GCPad_16Mhz.cpp ../NESPad.cpp \
-../PS2Pad.cpp ../saturn.cpp ../tg16.cpp
+../PS2Pad.cpp ../saturn.cpp ../tg16.cpp ../padmap.cpp ../ticks.cpp ../stickmap.cpp ../turbo.cpp ../macro.cpp ../socd.cpp ../detect.cpp ../settings.cpp
 
 
 # List Assembler source files here.
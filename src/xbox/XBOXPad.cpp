@@ -17,9 +17,16 @@
  */
 
 #include "XBOXPad.h"
+#include "../ticks.h"
+#include "../settings.h"
 
 static int padDetected = 0;
 
+// Motor values from the last rumble packet on the OUT endpoint
+static uint8_t rumble_small;
+static uint8_t rumble_large;
+static bool rumble_changed;
+
 /* ------------------------------------------------------------------------- */
 /* ----------------------------- USB interface ----------------------------- */
 /* ------------------------------------------------------------------------- */
@@ -113,6 +120,8 @@ void xbox_init(bool watchdog) {
 
 	xbox_reset_pad_status();
 
+	ticks_init();
+
 	if(watchdog) {
 		wdt_enable(WDTO_2S);
 	} else {
@@ -142,6 +151,8 @@ void xbox_reset_watchdog() {
 }
 
 void xbox_send_pad_state() {
+	settings_task();
+
 	while (!usbInterruptIsReady3())
 		usbPoll();
 	usbSetInterrupt3((unsigned char *) &gamepad_state, 20);
@@ -187,3 +198,25 @@ int xbox_pad_detected() {
 	return padDetected;
 }
 
+void usbFunctionWriteOut(uchar *data, uchar len) {
+	// Rumble packet: { 0x00, 0x06, 0x00, left (large) motor, 0x00, right (small) motor }
+	if(len >= 6 && data[0] == 0x00 && data[1] == 0x06) {
+		rumble_large = data[3];
+		rumble_small = data[5];
+		rumble_changed = true;
+	}
+}
+
+// Returns true and the latest motor values if the host sent a new rumble
+// packet since the last call.
+bool xbox_get_rumble(uint8_t *small, uint8_t *large) {
+	if(!rumble_changed)
+		return false;
+
+	rumble_changed = false;
+
+	*small = rumble_small;
+	*large = rumble_large;
+
+	return true;
+}
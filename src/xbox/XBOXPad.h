@@ -24,6 +24,7 @@
 #include <avr/interrupt.h>  /* for sei() */
 #include <util/delay.h>     /* for _delay_ms() */
 #include <string.h>			/* for memset() */
+#include <stddef.h>			/* for offsetof() */
 
 #include <avr/pgmspace.h>   /* required by usbdrv.h */
 
@@ -57,6 +58,7 @@ void xbox_init(bool watchdog);
 void xbox_reset_watchdog();
 void xbox_send_pad_state();
 int xbox_pad_detected();
+bool xbox_get_rumble(uint8_t *small, uint8_t *large);
 
 extern gamepad_state_t gamepad_state;
 
@@ -69,4 +71,18 @@ extern gamepad_state_t gamepad_state;
 #define XBOX_LEFT_STICK		6
 #define XBOX_RIGHT_STICK	7
 
+// Report byte and bits of each button, for padmap_t tables (see padmap.h)
+#define XBOX_MAP_A			offsetof(gamepad_state_t, a), 0xFF
+#define XBOX_MAP_B			offsetof(gamepad_state_t, b), 0xFF
+#define XBOX_MAP_X			offsetof(gamepad_state_t, x), 0xFF
+#define XBOX_MAP_Y			offsetof(gamepad_state_t, y), 0xFF
+#define XBOX_MAP_BLACK		offsetof(gamepad_state_t, black), 0xFF
+#define XBOX_MAP_WHITE		offsetof(gamepad_state_t, white), 0xFF
+#define XBOX_MAP_L			offsetof(gamepad_state_t, l), 0xFF
+#define XBOX_MAP_R			offsetof(gamepad_state_t, r), 0xFF
+#define XBOX_MAP_START		offsetof(gamepad_state_t, digital_buttons), _BV(XBOX_START)
+#define XBOX_MAP_BACK		offsetof(gamepad_state_t, digital_buttons), _BV(XBOX_BACK)
+#define XBOX_MAP_LEFT_STICK	offsetof(gamepad_state_t, digital_buttons), _BV(XBOX_LEFT_STICK)
+#define XBOX_MAP_RIGHT_STICK	offsetof(gamepad_state_t, digital_buttons), _BV(XBOX_RIGHT_STICK)
+
 #endif /* XBOXPAD_H_ */
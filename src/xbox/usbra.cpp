@@ -24,100 +24,149 @@
 #include "../NESPad.h"
 #include "../GCPad_16Mhz.h"
 #include "../tg16.h"
-
-// Arcade mode detection pin
-#define ARCADE_DB9_PIN	12
-
-// Extension cable detection pins
-#define DETPIN0 6  // DB9P2
-#define DETPIN1	8  // DB9P4
-#define DETPIN2	9  // DB9P6
-#define DETPIN3	10 // DB9P7
-#define DETPIN4	11 // DB9P9
-
-// Possible values (as of today) returned by the detectPad() routine
-// Normal pads
-#define PAD_ARCADE		-1
-#define PAD_GENESIS		0b00111
-#define PAD_NES 		0b00110
-#define PAD_SNES 		0b00101
-#define PAD_PS2 		0b00100
-#define PAD_GC	 		0b00011
-#define PAD_N64			0b00010
-#define PAD_NEOGEO		0b00001
-#define PAD_WIICC		0b00000
-// Extended pads (uses DB9 pin 4 and/or 2 for identification)
-#define PAD_SATURN		0b01111
-#define PAD_TG16		0b10111
-#define PAD_DFU_DONGLE	0b01110 // Reserved for USBRA DFU dongle
-
-/*
- * This is the new auto-detect function (non jumper based) which detects the extension
- * cable plugged in the DB9 port. It uses grounded pins from DB9 (4, 6, 7 and 9) for
- * the detection.
- *
- *  -1 - Arcade
- * 00111 - Sega Genesis (Default)
- * 00110 - NES
- * 00101 - SNES
- * 00100 - PS2
- * 00011 - Game Cube
- * 00010 - Nintendo 64
- * 00001 - Neo Geo
- * 00000 - Reserved 1
- * 01111 - Sega Saturn
- * 10111 - TurboGrafx 16
- */
-int detectPad() {
-	int pad;
-
-	// Set pad/arcade detection pins as input, turning pull-ups on
-	pinMode(DETPIN0, INPUT);
-	digitalWrite(DETPIN0, HIGH);
-
-	pinMode(DETPIN1, INPUT);
-	digitalWrite(DETPIN1, HIGH);
-
-	pinMode(DETPIN2, INPUT);
-	digitalWrite(DETPIN2, HIGH);
-
-	pinMode(DETPIN3, INPUT);
-	digitalWrite(DETPIN3, HIGH);
-
-	pinMode(DETPIN4, INPUT);
-	digitalWrite(DETPIN4, HIGH);
-
-	pinMode(ARCADE_DB9_PIN, INPUT);
-	digitalWrite(ARCADE_DB9_PIN, HIGH);
-
-	// Check switch for Arcade position
-	if(digitalRead(ARCADE_DB9_PIN))
-		return PAD_ARCADE;
-
-	pad = (!digitalRead(DETPIN0) << 4) | (!digitalRead(DETPIN1) << 3) | (digitalRead(DETPIN2) << 2) | (digitalRead(DETPIN3) << 1) | (digitalRead(DETPIN4));
-
-	if((pad >> 3) & 0b11) {
-		switch(pad) {
-		case 0b11011:
-		case 0b10111:
-			return PAD_TG16;
-			break;
-		case 0b11111:
-		case 0b01111:
-			return PAD_SATURN;
-			break;
-		case 0b11100:
-			return PAD_PS2;
-			break;
-		default:
-			return PAD_GENESIS;
-			break;
-		}
-	}
-
-	return (pad & 0b111);
+#include "../padmap.h"
+#include "../stickmap.h"
+#include "../macro.h"
+#include "../socd.h"
+#include "../detect.h"
+#include "../paddriver.h"
+
+// Button mapping tables, one per pad (see padmap.h)
+const PROGMEM padmap_t genesis_map[] = {
+	{ GENESIS_A, XBOX_MAP_A },
+	{ GENESIS_B, XBOX_MAP_B },
+	{ GENESIS_C, XBOX_MAP_BLACK },
+	{ GENESIS_X, XBOX_MAP_X },
+	{ GENESIS_Y, XBOX_MAP_Y },
+	{ GENESIS_Z, XBOX_MAP_WHITE },
+	{ GENESIS_MODE, XBOX_MAP_BACK },
+	{ GENESIS_START, XBOX_MAP_START },
+	{ GENESIS_UP | GENESIS_START, XBOX_MAP_RIGHT_STICK },
+	{ 0 }
+};
+
+const PROGMEM padmap_t arcade_map[] = {
+	{ 0x10, XBOX_MAP_X },
+	{ 0x20, XBOX_MAP_A },
+	{ 0x40, XBOX_MAP_Y },
+	{ 0x80, XBOX_MAP_B },
+	{ 0x100, XBOX_MAP_WHITE },
+	{ 0x200, XBOX_MAP_BLACK },
+	{ 0x400, XBOX_MAP_L },
+	{ 0x800, XBOX_MAP_R },
+	{ 0x1000, XBOX_MAP_BACK },
+	{ 0x2000, XBOX_MAP_START },
+	{ 0x4000, XBOX_MAP_LEFT_STICK },
+	{ 0x8000, XBOX_MAP_RIGHT_STICK },
+	{ 0 }
+};
+
+const PROGMEM padmap_t nes_map[] = {
+	{ 2, XBOX_MAP_B },
+	{ 1, XBOX_MAP_A },
+	{ 4, XBOX_MAP_BACK },
+	{ 8, XBOX_MAP_START },
+	{ 4 | 8, XBOX_MAP_RIGHT_STICK },
+	{ 0 }
+};
+
+const PROGMEM padmap_t snes_map[] = {
+	{ 1, XBOX_MAP_A },
+	{ 256, XBOX_MAP_B },
+	{ 2, XBOX_MAP_X },
+	{ 512, XBOX_MAP_Y },
+	{ 1024, XBOX_MAP_L },
+	{ 2048, XBOX_MAP_R },
+	{ 4, XBOX_MAP_BACK },
+	{ 8, XBOX_MAP_START },
+	{ 4 | 8, XBOX_MAP_RIGHT_STICK },
+	{ 0 }
+};
+
+const PROGMEM padmap_t ps2_map[] = {
+	{ PSB_SQUARE, XBOX_MAP_X },
+	{ PSB_TRIANGLE, XBOX_MAP_Y },
+	{ PSB_CROSS, XBOX_MAP_A },
+	{ PSB_CIRCLE, XBOX_MAP_B },
+	{ PSB_START, XBOX_MAP_START },
+	{ PSB_SELECT, XBOX_MAP_BACK },
+	{ PSB_L3, XBOX_MAP_LEFT_STICK },
+	{ PSB_R3, XBOX_MAP_RIGHT_STICK },
+	{ PSB_L2, XBOX_MAP_L },
+	{ PSB_R2, XBOX_MAP_R },
+	{ PSB_L1, XBOX_MAP_WHITE },
+	{ PSB_R1, XBOX_MAP_BLACK },
+	{ 0 }
+};
+
+// GC and N64 raw words are (button_data[0] << 8) | button_data[1]
+const PROGMEM padmap_t gc_map[] = {
+	{ 0x0800, XBOX_MAP_X },
+	{ 0x0200, XBOX_MAP_A },
+	{ 0x0400, XBOX_MAP_Y },
+	{ 0x0100, XBOX_MAP_B },
+	{ 0x1000, XBOX_MAP_START },
+	{ 0x0040, XBOX_MAP_L },
+	{ 0x0020, XBOX_MAP_R },
+	{ 0x0010, XBOX_MAP_BLACK },
+	{ 0x1008, XBOX_MAP_RIGHT_STICK },
+	{ 0 }
+};
+
+const PROGMEM padmap_t n64_map[] = {
+	{ 0x4000, XBOX_MAP_X },
+	{ 0x8000, XBOX_MAP_A },
+	{ 0x1000, XBOX_MAP_START },
+	{ 0x0020, XBOX_MAP_L },
+	{ 0x0010, XBOX_MAP_R },
+	{ 0x2000, XBOX_MAP_BLACK },
+	{ 0x1800, XBOX_MAP_RIGHT_STICK },
+	{ 0 }
+};
+
+const PROGMEM padmap_t neogeo_map[] = {
+	{ 0x8000, XBOX_MAP_X },
+	{ 0x01, XBOX_MAP_A },
+	{ 0x400, XBOX_MAP_B },
+	{ 0x200, XBOX_MAP_Y }, // D button is also 0x2000
+	{ 0x100, XBOX_MAP_BACK },
+	{ 0x4000, XBOX_MAP_START },
+	{ 0x100 | 0x4000, XBOX_MAP_RIGHT_STICK },
+	{ 0 }
+};
+
+const PROGMEM padmap_t saturn_map[] = {
+	{ SATURN_A, XBOX_MAP_A },
+	{ SATURN_B, XBOX_MAP_B },
+	{ SATURN_C, XBOX_MAP_BLACK },
+	{ SATURN_X, XBOX_MAP_X },
+	{ SATURN_Y, XBOX_MAP_Y },
+	{ SATURN_Z, XBOX_MAP_WHITE },
+	{ SATURN_L, XBOX_MAP_L },
+	{ SATURN_R, XBOX_MAP_R },
+	{ SATURN_START, XBOX_MAP_START },
+	{ SATURN_UP | SATURN_START, XBOX_MAP_RIGHT_STICK },
+	{ 0 }
+};
+
+const PROGMEM padmap_t tg16_map[] = {
+	{ 1 << TG16_I, XBOX_MAP_A },
+	{ 1 << TG16_II, XBOX_MAP_X },
+	{ 1 << TG16_RUN, XBOX_MAP_START },
+	{ 1 << TG16_SELECT, XBOX_MAP_BACK },
+	{ (1 << TG16_RUN) | (1 << TG16_SELECT), XBOX_MAP_RIGHT_STICK },
+	{ 0 }
+};
+
+// The direction nibble uses the same bit order as the XBOX D-PAD buttons
+void set_dpad(byte dir) {
+	gamepad_state.digital_buttons = (gamepad_state.digital_buttons & 0xF0) | dir;
 }
 
+// Widens a 0x00..0xFF axis (0x80 at rest) to the XBOX -32768..32767 range
+int stick_16(byte axis) {
+	return (int) ((((word) axis << 8) | axis) ^ 0x8000);
+}
 
 void setup() {
 	// Initialize USB joystick driver
@@ -131,294 +180,239 @@ void setup() {
 	}
 }
 
-void genesis_loop() {
-	int button_data;
-
-	genesis_init();
-
-	for (;;) {
-
-		xbox_reset_watchdog();
-
-		button_data = genesis_read();
-
-		(button_data & GENESIS_UP)    ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_UP)    : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_UP);
-		(button_data & GENESIS_DOWN)  ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_DOWN)  : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_DOWN);
-		(button_data & GENESIS_LEFT)  ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_LEFT)  : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_LEFT);
-		(button_data & GENESIS_RIGHT) ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_RIGHT) : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_RIGHT);
-
-		gamepad_state.a = ((button_data & GENESIS_A) > 0) * 0xFF;
-
-		gamepad_state.b = ((button_data & GENESIS_B) > 0) * 0xFF;
-
-		gamepad_state.black = ((button_data & GENESIS_C) > 0) * 0xFF;
-
-		gamepad_state.x = ((button_data & GENESIS_X) > 0) * 0xFF;
-
-		gamepad_state.y = ((button_data & GENESIS_Y) > 0) * 0xFF;
-
-		gamepad_state.white = ((button_data & GENESIS_Z) > 0) * 0xFF;
-
-		(button_data & GENESIS_MODE) ? bitSet(gamepad_state.digital_buttons, XBOX_BACK) : bitClear(gamepad_state.digital_buttons, XBOX_BACK);
-
-		(button_data & GENESIS_START) ? bitSet(gamepad_state.digital_buttons, XBOX_START) : bitClear(gamepad_state.digital_buttons, XBOX_START);
-
-		((button_data & GENESIS_UP) && (button_data & GENESIS_START)) ? bitSet(gamepad_state.digital_buttons, XBOX_RIGHT_STICK) : bitClear(gamepad_state.digital_buttons, XBOX_RIGHT_STICK);
-
-		xbox_send_pad_state();
-	}
-}
-
-void arcade_loop() {
-	int button_data;
-
-	NESPad::init(6, 7, 13);
-
-	for (;;) {
-
-		xbox_reset_watchdog();
-
-		button_data = NESPad::read(16);
-
-		(button_data & 0x01) ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_UP)    : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_UP);
-		(button_data & 0x02) ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_DOWN)  : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_DOWN);
-		(button_data & 0x04) ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_LEFT)  : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_LEFT);
-		(button_data & 0x08) ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_RIGHT) : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_RIGHT);
-
-		gamepad_state.x = ((button_data & 0x10) > 0) * 0xFF;
-
-		gamepad_state.a = ((button_data & 0x20) > 0) * 0xFF;
-
-		gamepad_state.y = ((button_data & 0x40) > 0) * 0xFF;
-
-		gamepad_state.b = ((button_data & 0x80) > 0) * 0xFF;
-
-		gamepad_state.white = ((button_data & 0x100) > 0) * 0xFF;
-
-		gamepad_state.black = ((button_data & 0x200) > 0) * 0xFF;
-
-		gamepad_state.l = ((button_data & 0x400) > 0) * 0xFF;
-
-		gamepad_state.r = ((button_data & 0x800) > 0) * 0xFF;
-
-		((button_data & 0x1000) > 0) ? bitSet(gamepad_state.digital_buttons, XBOX_BACK) : bitClear(gamepad_state.digital_buttons, XBOX_BACK);
-
-		((button_data & 0x2000) > 0) ? bitSet(gamepad_state.digital_buttons, XBOX_START) : bitClear(gamepad_state.digital_buttons, XBOX_START);
-
-		((button_data & 0x4000) > 0) ? bitSet(gamepad_state.digital_buttons, XBOX_LEFT_STICK) : bitClear(gamepad_state.digital_buttons, XBOX_LEFT_STICK);
-
-		((button_data & 0x8000) > 0) ? bitSet(gamepad_state.digital_buttons, XBOX_RIGHT_STICK) : bitClear(gamepad_state.digital_buttons, XBOX_RIGHT_STICK);
-
-		xbox_send_pad_state();
-	}
-}
-
-void nes_loop() {
-	int button_data;
+// Loop of the digital pads, one instance per driver (see paddriver.h)
+template <class Pad>
+void digital_loop(const padmap_t *map) {
+	typename Pad::state_t button_data = ~0;
 
-	NESPad::init(5, 6, 7);
+	padmap_load(Pad::padmap);
 
-	for (;;) {
+	Pad::init();
 
-		xbox_reset_watchdog();
-
-		button_data = NESPad::read(8);
-
-		(button_data & 16)  ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_UP)    : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_UP);
-		(button_data & 32)  ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_DOWN)  : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_DOWN);
-		(button_data & 64)  ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_LEFT)  : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_LEFT);
-		(button_data & 128) ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_RIGHT) : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_RIGHT);
-
-		gamepad_state.b = ((button_data & 2) > 0) * 0xFF;
-
-		gamepad_state.a = ((button_data & 1) > 0) * 0xFF;
-
-		((button_data & 4) > 0) ? bitSet(gamepad_state.digital_buttons, XBOX_BACK) : bitClear(gamepad_state.digital_buttons, XBOX_BACK);
-
-		((button_data & 8) > 0) ? bitSet(gamepad_state.digital_buttons, XBOX_START) : bitClear(gamepad_state.digital_buttons, XBOX_START);
-
-		((button_data & 4) && (button_data & 8)) ? bitSet(gamepad_state.digital_buttons, XBOX_RIGHT_STICK) : bitClear(gamepad_state.digital_buttons, XBOX_RIGHT_STICK);
-
-		xbox_send_pad_state();
-	}
-}
-
-void snes_loop() {
-	int button_data;
-
-	NESPad::init(5, 6, 7);
+	if(Pad::caps & PAD_CAP_MACRO)
+		macro_init(0x1000 | 0x2000); // START + BACK
 
 	for (;;) {
 
 		xbox_reset_watchdog();
 
-		button_data = NESPad::read(16);
-
-		(button_data & 16)  ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_UP)    : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_UP);
-		(button_data & 32)  ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_DOWN)  : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_DOWN);
-		(button_data & 64)  ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_LEFT)  : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_LEFT);
-		(button_data & 128) ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_RIGHT) : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_RIGHT);
+		// Checked before the read, with the last pass's buttons: right after
+		// a read, a Genesis 6-button pad's counter hasn't reset yet
+		if(detect_changed(button_data == 0 && Pad::quiet()))
+			return;
 
-		gamepad_state.a = ((button_data & 1) > 0) * 0xFF;
-		gamepad_state.b = ((button_data & 256) > 0) * 0xFF;
-		gamepad_state.x = ((button_data & 2) > 0) * 0xFF;
-		gamepad_state.y = ((button_data & 512) > 0) * 0xFF;
+		// xbox_send_pad_state() waits for each host poll, so every pass is
+		// one report slot as macro_frame() needs
+		button_data = Pad::poll();
 
-		gamepad_state.l = ((button_data & 1024) > 0) * 0xFF;
-		gamepad_state.r = ((button_data & 2048) > 0) * 0xFF;
+		if((Pad::caps & PAD_CAP_MACRO) && macro_engaged(button_data))
+			button_data = macro_frame(button_data);
 
-		((button_data & 4) > 0) ? bitSet(gamepad_state.digital_buttons, XBOX_BACK) : bitClear(gamepad_state.digital_buttons, XBOX_BACK);
+		set_dpad(socd_resolve(padmap_dir(button_data, Pad::up, Pad::down, Pad::left, Pad::right)));
 
-		((button_data & 8) > 0) ? bitSet(gamepad_state.digital_buttons, XBOX_START) : bitClear(gamepad_state.digital_buttons, XBOX_START);
-
-		((button_data & 4) && (button_data & 8)) ? bitSet(gamepad_state.digital_buttons, XBOX_RIGHT_STICK) : bitClear(gamepad_state.digital_buttons, XBOX_RIGHT_STICK);
+		padmap_apply(map, button_data, (uint8_t *) &gamepad_state);
 
 		xbox_send_pad_state();
 	}
 }
 
 void ps2_loop() {
-	byte dir = 0;
+	word button_data;
+	uint8_t small, large;
+	byte lx, ly, rx, ry;
 
 	while (PS2Pad::init(true)) {
 		xbox_reset_watchdog();
 		delayMicroseconds(10000); // 10ms delay
 		xbox_send_pad_state();
+
+		if(detect_changed(true))
+			return;
 	}
 
+	stickmap_init(STICKMAP_PS2);
+
 	for (;;) {
 
 		xbox_reset_watchdog();
 
+		if(xbox_get_rumble(&small, &large))
+			PS2Pad::rumble(small, large);
+
 		PS2Pad::read();
 
 		if(PS2Pad::type() == 0) { // Digital Pad
+			lx = ly = rx = ry = 0x80;
+
 			gamepad_state.l_x = 0;
 			gamepad_state.l_y = 0;
 			gamepad_state.r_x = 0;
 			gamepad_state.r_y = 0;
 		} else {
-			gamepad_state.l_x = map(PS2Pad::stick(PSS_LX), 0, 255, -32768, 32767);
-			gamepad_state.l_y = map(PS2Pad::stick(PSS_LY), 0, 255, 32767, -32768);
-			gamepad_state.r_x = map(PS2Pad::stick(PSS_RX), 0, 255, -32768, 32767);
-			gamepad_state.r_y = map(PS2Pad::stick(PSS_RY), 0, 255, 32767, -32768);
+			lx = PS2Pad::stick(PSS_LX);
+			ly = PS2Pad::stick(PSS_LY);
+			rx = PS2Pad::stick(PSS_RX);
+			ry = PS2Pad::stick(PSS_RY);
+
+			stickmap_apply(STICKMAP_LEFT, &lx, &ly);
+			stickmap_apply(STICKMAP_RIGHT, &rx, &ry);
+
+			gamepad_state.l_x = stick_16(lx);
+			gamepad_state.l_y = stick_16(~ly);
+			gamepad_state.r_x = stick_16(rx);
+			gamepad_state.r_y = stick_16(~ry);
 		}
 
+		button_data = PS2Pad::psx_buttons();
 
-		PS2Pad::button(PSB_PAD_UP)    ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_UP)    : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_UP);
-		PS2Pad::button(PSB_PAD_DOWN)  ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_DOWN)  : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_DOWN);
-		PS2Pad::button(PSB_PAD_LEFT)  ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_LEFT)  : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_LEFT);
-		PS2Pad::button(PSB_PAD_RIGHT) ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_RIGHT) : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_RIGHT);
-
-		gamepad_state.x = PS2Pad::button(PSB_SQUARE) * 0xFF;
-		gamepad_state.y = PS2Pad::button(PSB_TRIANGLE) * 0xFF;
-		gamepad_state.a = PS2Pad::button(PSB_CROSS) * 0xFF;
-		gamepad_state.b = PS2Pad::button(PSB_CIRCLE) * 0xFF;
-
-		PS2Pad::button(PSB_START) ? bitSet(gamepad_state.digital_buttons, XBOX_START) : bitClear(gamepad_state.digital_buttons, XBOX_START);
-		PS2Pad::button(PSB_SELECT) ? bitSet(gamepad_state.digital_buttons, XBOX_BACK) : bitClear(gamepad_state.digital_buttons, XBOX_BACK);
-		PS2Pad::button(PSB_L3) ? bitSet(gamepad_state.digital_buttons, XBOX_LEFT_STICK) : bitClear(gamepad_state.digital_buttons, XBOX_LEFT_STICK);
-		PS2Pad::button(PSB_R3) ? bitSet(gamepad_state.digital_buttons, XBOX_RIGHT_STICK) : bitClear(gamepad_state.digital_buttons, XBOX_RIGHT_STICK);
+		set_dpad(socd_resolve(padmap_dir(button_data, PSB_PAD_UP, PSB_PAD_DOWN, PSB_PAD_LEFT, PSB_PAD_RIGHT)));
 
-		gamepad_state.l = PS2Pad::button(PSB_L2) * 0xFF;
-		gamepad_state.r = PS2Pad::button(PSB_R2) * 0xFF;
-
-		gamepad_state.white = PS2Pad::button(PSB_L1) * 0xFF;
-		gamepad_state.black = PS2Pad::button(PSB_R1) * 0xFF;
+		padmap_apply(ps2_map, button_data, (uint8_t *) &gamepad_state);
 
 		xbox_send_pad_state();
+
+		if(detect_changed(button_data == 0 && PS2Pad::bus_idle() &&
+				detect_stick_idle(lx, ly) && detect_stick_idle(rx, ry)))
+			return;
 	}
 }
 
 void gc_loop() {
 	byte *button_data;
-	byte dir = 0;
+	word buttons;
+	byte lx, ly, rx, ry;
+	bool lost = false;
 
 	while(GCPad_init() == 0) {
 		xbox_reset_watchdog();
 		delayMicroseconds(10000); // 10ms delay
 		xbox_send_pad_state();
+
+		if(detect_changed(true))
+			return;
 	}
 
+	// xbox_send_pad_state() returns right after a host poll, take the stick
+	// origins then
+	xbox_send_pad_state();
+	GCPad_origin();
+
+	stickmap_init(STICKMAP_GC);
+
 	for(;;) {
 
 		xbox_reset_watchdog();
 
+		// xbox_send_pad_state() returns right after a host poll, so the pad
+		// is read while the bus is quiet
 		button_data = GCPad_read();
 
-		((button_data[1] & 0x08) > 0) ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_UP)    : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_UP);
-		((button_data[1] & 0x04) > 0) ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_DOWN)  : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_DOWN);
-		((button_data[1] & 0x01) > 0) ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_LEFT)  : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_LEFT);
-		((button_data[1] & 0x02) > 0) ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_RIGHT) : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_RIGHT);
+		// No reply: the pad was pulled. Release its buttons and check the
+		// cable straight away. A pad answering again may be another one, so
+		// the driver restarts to take its origins.
+		if(!button_data) {
+			lost = true;
+			xbox_reset_pad_status();
+			xbox_send_pad_state();
 
-		gamepad_state.x = ((button_data[0] & 0x08) > 0) * 0xFF;
+			if(detect_changed(true))
+				return;
 
-		gamepad_state.a = ((button_data[0] & 0x02) > 0) * 0xFF;
-
-		gamepad_state.y = ((button_data[0] & 0x04) > 0) * 0xFF;
+			continue;
+		}
 
-		gamepad_state.b = ((button_data[0] & 0x01) > 0) * 0xFF;
+		if(lost)
+			return;
 
-		((button_data[0] & 0x10) > 0) ? bitSet(gamepad_state.digital_buttons, XBOX_START) : bitClear(gamepad_state.digital_buttons, XBOX_START);
+		buttons = (button_data[0] << 8) | button_data[1];
 
-		gamepad_state.l = ((button_data[1] & 0x40) > 0) * 0xFF;
+		set_dpad(socd_resolve(padmap_dir(buttons, 0x0008, 0x0004, 0x0001, 0x0002)));
 
-		gamepad_state.r = ((button_data[1] & 0x20) > 0) * 0xFF;
+		padmap_apply(gc_map, buttons, (uint8_t *) &gamepad_state);
 
-		gamepad_state.black = ((button_data[1] & 0x10) > 0) * 0xFF;
+		lx = GCPad_axis(GC_STICK_X, false);
+		ly = GCPad_axis(GC_STICK_Y, false);
+		rx = GCPad_axis(GC_C_X, false);
+		ry = GCPad_axis(GC_C_Y, false);
 
-		gamepad_state.l_x = map(button_data[2], 32, 223, -32768, 32767);
-		gamepad_state.l_y = map((byte)~button_data[3], 32, 223, 32767, -32768);
-		gamepad_state.r_x = map(button_data[4], 32, 223, -32768, 32767);
-		gamepad_state.r_y = map((byte)~button_data[5], 32, 223, 32767, -32768);
+		stickmap_apply(STICKMAP_LEFT, &lx, &ly);
+		stickmap_apply(STICKMAP_RIGHT, &rx, &ry);
 
-		((button_data[1] & 0x08) && (button_data[0] & 0x10)) ? bitSet(gamepad_state.digital_buttons, XBOX_RIGHT_STICK) : bitClear(gamepad_state.digital_buttons, XBOX_RIGHT_STICK);
+		gamepad_state.l_x = stick_16(lx);
+		gamepad_state.l_y = stick_16(ly);
+		gamepad_state.r_x = stick_16(rx);
+		gamepad_state.r_y = stick_16(ry);
 
 		xbox_send_pad_state();
 
-		delayMicroseconds(5000);
+		if(detect_changed(!(buttons & GC_BUTTONS) && detect_stick_idle(lx, ly) && detect_stick_idle(rx, ry)))
+			return;
 	}
 }
 
 void n64_loop() {
 	byte *button_data;
-	byte dir = 0;
+	word buttons;
+	uint8_t small, large;
 	byte lx, ly;
+	bool lost = false;
 
 	while(GCPad_init() == 0) {
 		xbox_reset_watchdog();
 		delayMicroseconds(10000); // 10ms delay
 		xbox_send_pad_state();
+
+		if(detect_changed(true))
+			return;
 	}
 
+	stickmap_init(STICKMAP_N64);
+
 	for(;;) {
 
 		xbox_reset_watchdog();
 
+		// xbox_send_pad_state() returns right after a host poll, so the pad
+		// is read while the bus is quiet
 		button_data = N64Pad_read();
 
-		((button_data[0] & 0x08) > 0) ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_UP)    : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_UP);
-		((button_data[0] & 0x04) > 0) ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_DOWN)  : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_DOWN);
-		((button_data[0] & 0x02) > 0) ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_LEFT)  : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_LEFT);
-		((button_data[0] & 0x01) > 0) ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_RIGHT) : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_RIGHT);
+		// No reply: the pad was pulled. Release its buttons and check the
+		// cable straight away. A pad answering again may be another one, so
+		// the driver restarts to probe its pak.
+		if(!button_data) {
+			lost = true;
+			xbox_reset_pad_status();
+			xbox_send_pad_state();
+
+			if(detect_changed(true))
+				return;
+
+			continue;
+		}
 
-		gamepad_state.x = ((button_data[0] & 0x40) > 0) * 0xFF;
+		if(lost)
+			return;
 
-		gamepad_state.a = ((button_data[0] & 0x80) > 0) * 0xFF;
+		// Every pass starts on a host poll, which leaves room for a pak
+		// block transfer (~1.2ms with interrupts off, see N64Pad_pak_due())
+		N64Pad_pak_task();
 
-		((button_data[0] & 0x10) > 0) ? bitSet(gamepad_state.digital_buttons, XBOX_START) : bitClear(gamepad_state.digital_buttons, XBOX_START);
+		if(xbox_get_rumble(&small, &large))
+			N64Pad_rumble(small || large);
 
-		gamepad_state.l = ((button_data[1] & 0x20) > 0) * 0xFF;
+		buttons = (button_data[0] << 8) | button_data[1];
 
-		gamepad_state.r = ((button_data[1] & 0x10) > 0) * 0xFF;
+		set_dpad(socd_resolve(padmap_dir(buttons, 0x0800, 0x0400, 0x0200, 0x0100)));
 
-		gamepad_state.black = ((button_data[0] & 0x20) > 0) * 0xFF;
+		padmap_apply(n64_map, buttons, (uint8_t *) &gamepad_state);
 
-		lx = ((button_data[2] >= 128) ? button_data[2] - 128 : button_data[2] + 128);
-		ly = ~((button_data[3] >= 128) ? button_data[3] - 128 : button_data[3] + 128);
+		lx = N64Pad_axis(N64_STICK_X, false);
+		ly = N64Pad_axis(N64_STICK_Y, false);
 
-		gamepad_state.l_x = map(lx, 32, 223, -32768, 32767);
-		gamepad_state.l_y = map(ly, 32, 223, 32767, -32768);
+		stickmap_apply(STICKMAP_LEFT, &lx, &ly);
+
+		gamepad_state.l_x = stick_16(lx);
+		gamepad_state.l_y = stick_16(ly);
 
 		gamepad_state.r_x = 0x00;
 		gamepad_state.r_y = 0x00;
@@ -435,154 +429,64 @@ void n64_loop() {
 			gamepad_state.r_x = 32767;
 		}
 
-		((button_data[0] & 0x08) && (button_data[0] & 0x10)) ? bitSet(gamepad_state.digital_buttons, XBOX_RIGHT_STICK) : bitClear(gamepad_state.digital_buttons, XBOX_RIGHT_STICK);
-
 		xbox_send_pad_state();
-	}
-}
 
-void neogeo_loop() {
-	int button_data;
-
-	NESPad::init(5, 6, 7);
-
-	for (;;) {
-
-		xbox_reset_watchdog();
-
-		button_data = NESPad::read(16);
-
-		(button_data & 0x04)   ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_UP)    : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_UP);
-		(button_data & 0x1000) ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_DOWN)  : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_DOWN);
-		(button_data & 0x02)   ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_LEFT)  : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_LEFT);
-		(button_data & 0x800) ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_RIGHT) : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_RIGHT);
-
-		gamepad_state.x = ((button_data & 0x8000) > 0) * 0xFF;
-
-		gamepad_state.a = ((button_data & 0x01) > 0) * 0xFF;
-
-		gamepad_state.b = ((button_data & 0x400) > 0) * 0xFF;
-
-		gamepad_state.y = ((button_data & 0x200) > 0) * 0xFF; // D button is also 0x2000
-
-		((button_data & 0x100) > 0)  ? bitSet(gamepad_state.digital_buttons, XBOX_BACK) : bitClear(gamepad_state.digital_buttons, XBOX_BACK);
-
-		((button_data & 0x4000) > 0) ? bitSet(gamepad_state.digital_buttons, XBOX_START) : bitClear(gamepad_state.digital_buttons, XBOX_START);
-
-		((button_data & 0x100) && (button_data & 0x4000)) ? bitSet(gamepad_state.digital_buttons, XBOX_RIGHT_STICK) : bitClear(gamepad_state.digital_buttons, XBOX_RIGHT_STICK);
-
-		xbox_send_pad_state();
+		if(detect_changed(!(buttons & N64_BUTTONS) && detect_stick_idle(lx, ly)))
+			return;
 	}
 }
 
-void saturn_loop() {
-	int button_data;
-
-	saturn_init();
-
-	for (;;) {
-
+void unsupported_pad(void) {
+	for(;;) {
 		xbox_reset_watchdog();
-
-		button_data = saturn_read();
-
-		(button_data & SATURN_UP)    ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_UP)    : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_UP);
-		(button_data & SATURN_DOWN)  ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_DOWN)  : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_DOWN);
-		(button_data & SATURN_LEFT)  ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_LEFT)  : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_LEFT);
-		(button_data & SATURN_RIGHT) ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_RIGHT) : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_RIGHT);
-
-		gamepad_state.a = ((button_data & SATURN_A) > 0) * 0xFF;
-
-		gamepad_state.b = ((button_data & SATURN_B) > 0) * 0xFF;
-
-		gamepad_state.black = ((button_data & SATURN_C) > 0) * 0xFF;
-
-		gamepad_state.x = ((button_data & SATURN_X) > 0) * 0xFF;
-
-		gamepad_state.y = ((button_data & SATURN_Y) > 0) * 0xFF;
-
-		gamepad_state.white = ((button_data & SATURN_Z) > 0) * 0xFF;
-		
-		gamepad_state.l = ((button_data & SATURN_L) > 0) * 0xFF;
-
-		gamepad_state.r = ((button_data & SATURN_R) > 0) * 0xFF;
-
-		(button_data & SATURN_START) ? bitSet(gamepad_state.digital_buttons, XBOX_START) : bitClear(gamepad_state.digital_buttons, XBOX_START);
-
-		((button_data & SATURN_UP) && (button_data & SATURN_START)) ? bitSet(gamepad_state.digital_buttons, XBOX_RIGHT_STICK) : bitClear(gamepad_state.digital_buttons, XBOX_RIGHT_STICK);
-
 		xbox_send_pad_state();
-	}
-}
 
-void tg16_loop(void) {
-	int button_data;
-
-	tg16_init();
-
-	for (;;) {
-		xbox_reset_watchdog();
-
-		button_data = tg16_read();
-
-		(button_data & (1 << TG16_UP))    ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_UP)    : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_UP);
-		(button_data & (1 << TG16_DOWN))  ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_DOWN)  : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_DOWN);
-		(button_data & (1 << TG16_LEFT))  ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_LEFT)  : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_LEFT);
-		(button_data & (1 << TG16_RIGHT)) ? bitSet(gamepad_state.digital_buttons, XBOX_DPAD_RIGHT) : bitClear(gamepad_state.digital_buttons, XBOX_DPAD_RIGHT);
-
-		gamepad_state.a = ((button_data & (1 << TG16_I)) > 0) * 0xFF;
-
-		gamepad_state.x = ((button_data & (1 << TG16_II)) > 0) * 0xFF;
-
-		(button_data & (1 << TG16_RUN)) ? bitSet(gamepad_state.digital_buttons, XBOX_START) : bitClear(gamepad_state.digital_buttons, XBOX_START);
-
-		(button_data & (1 << TG16_SELECT)) ? bitSet(gamepad_state.digital_buttons, XBOX_BACK) : bitClear(gamepad_state.digital_buttons, XBOX_BACK);
-
-		((button_data & (1 << TG16_RUN)) && (button_data & (1 << TG16_SELECT))) ? bitSet(gamepad_state.digital_buttons, XBOX_RIGHT_STICK) : bitClear(gamepad_state.digital_buttons, XBOX_RIGHT_STICK);
-
-		xbox_send_pad_state();
+		if(detect_changed(true))
+			return;
 	}
 }
 
-
-void unsupported_pad(void) {
-	for(;;);
-}
-
+// Runs the driver of the pad plugged in, and again whenever its loop returns
+// because the cable changed (see detect.h)
 void loop() {
+	xbox_reset_pad_status();
+
 	switch (detectPad()) {
 	case PAD_ARCADE:
-		arcade_loop();
+		digital_loop<ArcadeDriver>(arcade_map);
 		break;
 	case PAD_NES:
-		nes_loop();
+		digital_loop<NESDriver>(nes_map);
 		break;
 	case PAD_SNES:
-		snes_loop();
+		digital_loop<SNESDriver>(snes_map);
 		break;
 	case PAD_PS2:
+		padmap_load(PADMAP_PS2);
 		ps2_loop();
 		break;
 	case PAD_GC:
+		padmap_load(PADMAP_GC);
 		gc_loop();
 		break;
 	case PAD_N64:
+		padmap_load(PADMAP_N64);
 		n64_loop();
 		break;
 	case PAD_NEOGEO:
-		neogeo_loop();
+		digital_loop<NeoGeoDriver>(neogeo_map);
 		break;
 	case PAD_SATURN:
-		saturn_loop();
+		digital_loop<SaturnDriver>(saturn_map);
 		break;
 	case PAD_TG16:
-		tg16_loop();
+		digital_loop<TG16Driver>(tg16_map);
 		break;
 	case PAD_WIICC:
 		unsupported_pad();
 		break;
 	default:
-		genesis_loop();
+		digital_loop<GenesisDriver>(genesis_map);
 		break;
 	}
 }
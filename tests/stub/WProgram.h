@@ -0,0 +1,56 @@
+/*
+ * Host stand-in for the Arduino core, with a GPIO mock for the pad drivers.
+ *
+ * Arduino pins 0-7 are PORTD and 8-13 PORTB, as on the ATmega328p. Every
+ * pinMode() and digitalWrite() of an output pin calls gpio_pad, the model of
+ * the pad on the other end, which sets the levels it drives in gpio_in[].
+ * PIND and PINB then read the output level of output pins and gpio_in[] of
+ * input pins; gpio_update() refreshes them after a test changes gpio_in[]
+ * itself. Writes to a PIN register (which toggle the pin on the AVR)
+ * aren't seen by the mock.
+ */
+#ifndef STUB_WPROGRAM_H_
+#define STUB_WPROGRAM_H_
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+typedef uint8_t byte;
+typedef uint16_t word;
+
+#define LOW		0
+#define HIGH	1
+#define INPUT	0
+#define OUTPUT	1
+
+#define GPIO_PINS	14
+
+extern uint8_t gpio_in[GPIO_PINS];
+extern void (*gpio_pad)(uint8_t pin, uint8_t level);
+
+void gpio_reset();
+void gpio_update();
+uint8_t gpio_level(uint8_t pin);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void delayMicroseconds(unsigned int us);
+
+#define noInterrupts()
+#define interrupts()
+
+#define digitalPinToPort(pin)		((pin) < 8 ? 4 : 2)
+#define digitalPinToBitMask(pin)	((uint8_t) _BV((pin) & 7))
+#define portInputRegister(port)		((port) == 4 ? &PIND : &PINB)
+
+// Keeps digitalWriteFast.h from using its register versions
+#define digitalPinToPortReg(pin)	((pin) < 8 ? &PORTD : &PORTB)
+#define __digitalPinToBit(pin)		((pin) & 7)
+#define digitalWriteFast(pin, value)	digitalWrite((pin), (value))
+#define pinModeFast(pin, mode)		pinMode((pin), (mode))
+#define digitalReadFast(pin)		digitalRead((pin))
+
+#endif
@@ -0,0 +1,34 @@
+/*
+ * Host stand-in for the EEPROM: test_eeprom[] holds its contents and counts
+ * the bytes written. Writes finish at once, so eeprom_is_ready() is always
+ * true.
+ */
+#ifndef STUB_AVR_EEPROM_H_
+#define STUB_AVR_EEPROM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <avr/io.h>
+
+extern uint8_t test_eeprom[E2END + 1];
+extern unsigned int test_eeprom_writes;
+
+static inline bool eeprom_is_ready() {
+	return true;
+}
+
+static inline uint8_t eeprom_read_byte(const uint8_t *address) {
+	return test_eeprom[(uintptr_t) address];
+}
+
+static inline void eeprom_write_byte(uint8_t *address, uint8_t value) {
+	test_eeprom[(uintptr_t) address] = value;
+	test_eeprom_writes++;
+}
+
+static inline void eeprom_read_block(void *data, const void *address, size_t length) {
+	memcpy(data, test_eeprom + (uintptr_t) address, length);
+}
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef STUB_AVR_INTERRUPT_H_
+#define STUB_AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+#define ISR(vector, ...) void vector()
+#define cli()
+#define sei()
+
+#endif
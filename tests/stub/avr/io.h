@@ -0,0 +1,29 @@
+/*
+ * Host stand-in for the ATmega328p registers the tested modules touch. They
+ * are plain variables (see stub.cpp); the GPIO ones are driven by the mock
+ * in WProgram.h.
+ */
+#ifndef STUB_AVR_IO_H_
+#define STUB_AVR_IO_H_
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+#define E2END 1023
+
+extern volatile uint8_t SREG;
+extern volatile uint8_t PINB, PORTB, DDRB, PIND, PORTD, DDRD;
+extern volatile uint8_t TCCR2A, TCCR2B, TCNT2, OCR2A, TIFR2, TIMSK2;
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1;
+extern volatile uint16_t TCNT1;
+
+#define CS12	2
+#define CS20	0
+#define CS21	1
+#define CS22	2
+#define WGM21	1
+#define OCF2A	1
+#define OCIE2A	1
+
+#endif
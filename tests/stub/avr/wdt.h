@@ -0,0 +1,14 @@
+/*
+ * Host stand-in for the watchdog: nothing to reset.
+ */
+#ifndef STUB_AVR_WDT_H_
+#define STUB_AVR_WDT_H_
+
+#define WDTO_1S	6
+#define WDTO_2S	7
+
+#define wdt_reset()
+#define wdt_enable(timeout)
+#define wdt_disable()
+
+#endif
@@ -0,0 +1,89 @@
+#include <WProgram.h>
+#include <avr/eeprom.h>
+
+volatile uint8_t SREG;
+volatile uint8_t PINB, PORTB, DDRB, PIND, PORTD, DDRD;
+volatile uint8_t TCCR2A, TCCR2B, TCNT2, OCR2A, TIFR2, TIMSK2;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1;
+volatile uint16_t TCNT1;
+
+uint8_t test_eeprom[E2END + 1];
+unsigned int test_eeprom_writes;
+
+uint8_t gpio_in[GPIO_PINS];
+void (*gpio_pad)(uint8_t pin, uint8_t level);
+
+static volatile uint8_t *port_reg(uint8_t pin) {
+	return pin < 8 ? &PORTD : &PORTB;
+}
+
+static volatile uint8_t *ddr_reg(uint8_t pin) {
+	return pin < 8 ? &DDRD : &DDRB;
+}
+
+// Recomputes PIND and PINB from the outputs and what the pad drives
+void gpio_update() {
+	uint8_t d = 0, b = 0;
+
+	for(uint8_t pin = 0; pin < GPIO_PINS; pin++) {
+		uint8_t mask = digitalPinToBitMask(pin);
+		uint8_t level = (*ddr_reg(pin) & mask) ? (*port_reg(pin) & mask) != 0 : gpio_in[pin];
+
+		if(level) {
+			if(pin < 8)
+				d |= mask;
+			else
+				b |= mask;
+		}
+	}
+
+	PIND = d;
+	PINB = b;
+}
+
+// Inputs released (high), outputs low, no pad model
+void gpio_reset() {
+	for(uint8_t pin = 0; pin < GPIO_PINS; pin++)
+		gpio_in[pin] = 1;
+
+	PORTB = PORTD = DDRB = DDRD = 0;
+	gpio_pad = 0;
+	gpio_update();
+}
+
+uint8_t gpio_level(uint8_t pin) {
+	return (*port_reg(pin) & digitalPinToBitMask(pin)) != 0;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+	if(mode == OUTPUT)
+		*ddr_reg(pin) |= digitalPinToBitMask(pin);
+	else
+		*ddr_reg(pin) &= ~digitalPinToBitMask(pin);
+
+	if(gpio_pad && mode == OUTPUT)
+		gpio_pad(pin, gpio_level(pin));
+
+	gpio_update();
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+	if(value)
+		*port_reg(pin) |= digitalPinToBitMask(pin);
+	else
+		*port_reg(pin) &= ~digitalPinToBitMask(pin);
+
+	if(gpio_pad && (*ddr_reg(pin) & digitalPinToBitMask(pin)))
+		gpio_pad(pin, value != 0);
+
+	gpio_update();
+}
+
+int digitalRead(uint8_t pin) {
+	return ((pin < 8 ? PIND : PINB) & digitalPinToBitMask(pin)) != 0;
+}
+
+// Time only matters to code reading Timer1 (ticks.h): advance it
+void delayMicroseconds(unsigned int us) {
+	TCNT1 += us * (F_CPU / 1000000UL) / 256;
+}
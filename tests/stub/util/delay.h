@@ -0,0 +1,13 @@
+/*
+ * Host stand-in for the busy waits: they advance the mock clock like
+ * delayMicroseconds().
+ */
+#ifndef STUB_UTIL_DELAY_H_
+#define STUB_UTIL_DELAY_H_
+
+void delayMicroseconds(unsigned int us);
+
+#define _delay_us(us)	delayMicroseconds(us)
+#define _delay_ms(ms)	delayMicroseconds((ms) * 1000)
+
+#endif
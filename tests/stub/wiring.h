@@ -0,0 +1 @@
+// Everything the firmware takes from wiring.h is in the mock WProgram.h
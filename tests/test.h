@@ -0,0 +1,32 @@
+/*
+ * Minimal checks for the host tests: CHECK() reports a failed condition and
+ * keeps going, test_done() prints the outcome and gives main()'s result.
+ */
+#ifndef TEST_H_
+#define TEST_H_
+
+#include <stdio.h>
+
+static int test_failures;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+		test_failures++; \
+	} \
+} while(0)
+
+#define CHECK_EQ(a, b) do { \
+	long _a = (long) (a), _b = (long) (b); \
+	if(_a != _b) { \
+		printf("%s:%d: %s == %s failed: %ld != %ld\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+		test_failures++; \
+	} \
+} while(0)
+
+static inline int test_done(const char *name) {
+	printf("%s: %s\n", name, test_failures ? "FAILED" : "ok");
+	return test_failures != 0;
+}
+
+#endif
@@ -0,0 +1,112 @@
+/*
+ * GameCube/N64 stick scale: the stick_scale[] table in GCPad_16Mhz.cpp
+ * against the formula it was generated with, and the axes it gives against
+ * the old map(x, 32, 223, 0, 255). GCPad_16Mhz.cpp is AVR assembly at heart
+ * and can't be built here, so the table is read from its source.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+
+#ifndef GCPAD_SOURCE
+#define GCPAD_SOURCE "../src/GCPad_16Mhz.cpp"
+#endif
+
+static int stick_scale[129];
+
+// Offset from 0x80 for a distance from the origin: 4/3 of it, rounded, up
+// to the full 128 (the old map() stretched 191 steps over 255)
+static int generate(int distance) {
+	int offset = (distance * 4 + 1) / 3;
+
+	return offset > 128 ? 128 : offset;
+}
+
+// Mirrors stick_axis() in GCPad_16Mhz.cpp
+static int stick_axis(int distance) {
+	int offset;
+
+	if(distance < 0)
+		return 0x80 - stick_scale[(distance < -128) ? 128 : -distance];
+
+	offset = stick_scale[(distance > 127) ? 127 : distance];
+	return 0x80 + ((offset > 0x7F) ? 0x7F : offset);
+}
+
+// Arduino's map(), integer math truncating towards zero
+static long arduino_map(long x, long in_min, long in_max, long out_min, long out_max) {
+	return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+static bool load_table() {
+	static char source[65536];
+	FILE *f = fopen(GCPAD_SOURCE, "rb");
+	size_t length;
+	char *p;
+
+	if(!f)
+		return false;
+
+	length = fread(source, 1, sizeof(source) - 1, f);
+	source[length] = 0;
+	fclose(f);
+
+	p = strstr(source, "stick_scale[129] = {");
+
+	if(!p)
+		return false;
+
+	p = strchr(p, '{') + 1;
+
+	for(int i = 0; i < 129; i++) {
+		char *end;
+
+		stick_scale[i] = strtol(p, &end, 0);
+
+		if(end == p)
+			return false;
+
+		p = end + strspn(end, ", \t\r\n");
+	}
+
+	return *p == '}';
+}
+
+int main() {
+	int worst = 0;
+
+	CHECK(load_table());
+
+	for(int d = 0; d <= 128; d++)
+		CHECK_EQ(stick_scale[d], generate(d));
+
+	for(int d = 1; d <= 128; d++)
+		CHECK(stick_scale[d] >= stick_scale[d - 1]);
+
+	// Raw readings with the origin at 0x80: within one step of the old map()
+	for(int x = 0; x <= 255; x++) {
+		long old = arduino_map(x, 32, 223, 0, 255);
+		int diff;
+
+		if(old < 0)
+			old = 0;
+		if(old > 255)
+			old = 255;
+
+		diff = abs(stick_axis(x - 0x80) - (int) old);
+
+		if(diff > worst)
+			worst = diff;
+	}
+
+	CHECK(worst <= 1);
+
+	// Rest is centre, full travel either way reaches the ends
+	CHECK_EQ(stick_axis(0), 0x80);
+	CHECK_EQ(stick_axis(-96), 0x00);
+	CHECK_EQ(stick_axis(96), 0xFF);
+	CHECK_EQ(stick_axis(-255), 0x00);
+	CHECK_EQ(stick_axis(255), 0xFF);
+
+	return test_done("gcscale");
+}
@@ -0,0 +1,159 @@
+/*
+ * macro: recording run-length encodes the frames into an EEPROM slot, and
+ * playing it back gives the same frames.
+ */
+#include <string.h>
+#include <avr/eeprom.h>
+#include "test.h"
+#include "macro.h"
+#include "settings.h"
+
+#define CHORD		0xA000	// START + HOME
+#define TRIGGER		0x0001
+
+// One pass of the pad loop: the macro engine, then the deferred writer that
+// vs_send_pad_state() runs
+static uint16_t frame(uint16_t buttons) {
+	if(macro_engaged(buttons))
+		buttons = macro_frame(buttons);
+
+	settings_task();
+
+	return buttons;
+}
+
+static void frames(uint16_t buttons, int count) {
+	while(count--)
+		frame(buttons);
+}
+
+// Chord, bind the trigger, then the sequence and the chord again
+static void record(uint16_t trigger, const uint16_t *sequence, int length) {
+	CHECK_EQ(frame(CHORD), 0);
+	CHECK_EQ(frame(0), 0);
+	CHECK_EQ(macro_state, MACRO_BIND);
+	CHECK_EQ(frame(trigger), 0);
+	CHECK_EQ(frame(0), 0);
+	CHECK_EQ(macro_state, MACRO_RECORD);
+
+	// Nothing is recorded before the first button goes down
+	frames(0, 5);
+
+	for(int i = 0; i < length; i++)
+		CHECK_EQ(frame(sequence[i]), sequence[i]);
+
+	CHECK_EQ(frame(CHORD), 0);
+}
+
+static int slot_steps(uint8_t slot) {
+	return test_eeprom[EE_MACRO + slot * MACRO_SLOT_SIZE + 1];
+}
+
+static const uint8_t *slot_step(uint8_t slot, uint8_t step) {
+	return test_eeprom + EE_MACRO + slot * MACRO_SLOT_SIZE + 2 + step * 3;
+}
+
+int main() {
+	static uint16_t sequence[400];
+	int length = 0, i;
+
+	memset(test_eeprom, 0xFF, sizeof(test_eeprom));
+	macro_init(CHORD);
+
+	// Idle with nothing bound: only the chord engages the engine
+	CHECK(!macro_engaged(0x0FFF));
+	CHECK(macro_engaged(CHORD));
+
+	for(i = 0; i < 3; i++) sequence[length++] = 0x0010;
+	for(i = 0; i < 2; i++) sequence[length++] = 0x0000;
+	for(i = 0; i < 300; i++) sequence[length++] = 0x0020;
+	sequence[length++] = 0x0130;
+
+	test_eeprom_writes = 0;
+	record(TRIGGER, sequence, length);
+
+	// The slot is written a byte per frame, the trigger stays off until then
+	CHECK_EQ(macro_watch, 0);
+	CHECK_EQ(frame(0), 0);
+	CHECK_EQ(macro_state, MACRO_IDLE);
+	CHECK_EQ(frame(TRIGGER), TRIGGER);
+	CHECK_EQ(macro_state, MACRO_IDLE);
+
+	frames(0, 40);
+	// Only the bytes that change are written: the 255 frame count is already
+	// there in erased EEPROM
+	CHECK_EQ(test_eeprom_writes, 2 + 5 * 3 - 1);
+	CHECK_EQ(macro_watch, CHORD | TRIGGER);
+
+	// Slot layout: trigger bit, step count, { buttons, frames } steps. Runs
+	// longer than 255 frames take several steps.
+	CHECK_EQ(test_eeprom[EE_MACRO], 0);
+	CHECK_EQ(slot_steps(0), 5);
+
+	const uint8_t steps[5][3] = {
+		{ 0x10, 0x00, 3 }, { 0x00, 0x00, 2 }, { 0x20, 0x00, 255 }, { 0x20, 0x00, 45 }, { 0x30, 0x01, 1 }
+	};
+
+	for(i = 0; i < 5; i++)
+		CHECK(!memcmp(slot_step(0, i), steps[i], 3));
+
+	// Playback repeats the recording frame by frame, whatever the pad does
+	CHECK_EQ(frame(TRIGGER), sequence[0]);
+	CHECK_EQ(macro_state, MACRO_PLAY);
+
+	for(i = 1; i < length; i++) {
+		uint16_t out = frame(i & 1 ? TRIGGER : 0x0FFF);
+
+		if(out != sequence[i]) {
+			CHECK_EQ(out, sequence[i]);
+			break;
+		}
+	}
+
+	// Then the trigger is held off until released
+	CHECK_EQ(macro_state, MACRO_WAIT);
+	CHECK_EQ(frame(TRIGGER | 0x0004), 0x0004);
+	CHECK_EQ(frame(0), 0);
+	CHECK_EQ(macro_state, MACRO_IDLE);
+
+	// Recording the same trigger again reuses its slot; a recording stops
+	// and saves itself when it runs out of steps
+	length = 0;
+
+	for(i = 0; i < MACRO_STEPS + 8; i++)
+		sequence[length++] = 0x0100 | i;
+
+	CHECK_EQ(frame(CHORD), 0);
+	frame(0);
+	frame(TRIGGER);
+	frame(0);
+
+	for(i = 0; i < length && macro_state == MACRO_RECORD; i++)
+		frame(sequence[i]);
+
+	CHECK_EQ(i, MACRO_STEPS);
+	CHECK_EQ(macro_state, MACRO_WAIT);
+
+	frames(0, 200);
+	CHECK_EQ(test_eeprom[EE_MACRO + MACRO_SLOT_SIZE], 0xFF);
+	CHECK_EQ(slot_steps(0), MACRO_STEPS);
+
+	for(i = 0; i < MACRO_STEPS; i++) {
+		CHECK_EQ(slot_step(0, i)[0], i);
+		CHECK_EQ(slot_step(0, i)[2], 1);
+	}
+
+	// A second trigger takes an empty slot
+	sequence[0] = 0x0040;
+	record(0x0002, sequence, 1);
+	frames(0, 40);
+	CHECK_EQ(test_eeprom[EE_MACRO + MACRO_SLOT_SIZE], 1);
+	CHECK_EQ(macro_watch, CHORD | TRIGGER | 0x0002);
+
+	// The slots survive a restart of the pad loop
+	macro_init(CHORD);
+	CHECK_EQ(macro_watch, CHORD | TRIGGER | 0x0002);
+	CHECK_EQ(frame(0x0002), 0x0040);
+
+	return test_done("macro");
+}
@@ -0,0 +1,301 @@
+/*
+ * usbra: the PS3 button tables and direction code against the per pad
+ * mapping code they replaced, on every raw button word. With erased EEPROM
+ * (no remap, turbo or SOCD) both must leave identical reports.
+ *
+ * The firmware's main file is included for its tables and helpers; the USB
+ * and GC/N64 drivers it calls are stubbed below.
+ */
+#include <string.h>
+#include <avr/eeprom.h>
+#include "test.h"
+#include "usbra.cpp"
+
+gamepad_state_t gamepad_state;
+
+gamepad_state_t *vs_player_state(uint8_t player) { return &gamepad_state; }
+void vs_reset_pad_status() {}
+void vs_init(bool watchdog) {}
+void vs_reset_watchdog() {}
+void vs_send_pad_state() {}
+void vs_wait_poll() {}
+void vs_wait_report() {}
+bool vs_get_rumble(uint8_t *small, uint8_t *large) { return false; }
+int detectPad() { return PAD_WIICC; }
+bool detect_changed(bool idle) { return true; }
+byte GCPad_init() { return 0; }
+bool GCPad_origin() { return true; }
+byte GCPad_axis(byte axis, bool invert) { return 0x80; }
+byte *GCPad_read() { return 0; }
+byte *N64Pad_read() { return 0; }
+byte N64Pad_axis(byte axis, bool invert) { return 0x80; }
+void N64Pad_rumble(bool on) {}
+void N64Pad_pak_task() {}
+bool N64Pad_pak_due() { return false; }
+
+// Hat values of the old code, indexed by U << 3 | D << 2 | L << 1 | R
+static const byte old_pad_dir[16] = {8, 2, 6, 8, 4, 3, 5, 8, 0, 1, 7, 8, 8, 8, 8, 8};
+
+#define OLD_BUTTON(btn, axis, pressed) \
+	s->btn = (pressed) > 0; \
+	s->axis = (s->btn ? 0xFF : 0x00);
+
+static void old_axes(gamepad_state_t *s, bool up, bool down, bool left, bool right) {
+	s->l_x_axis = left ? 0x00 : right ? 0xFF : 0x80;
+	s->l_y_axis = up ? 0x00 : down ? 0xFF : 0x80;
+}
+
+static void old_genesis(uint16_t b, gamepad_state_t *s) {
+	old_axes(s, b & GENESIS_UP, b & GENESIS_DOWN, b & GENESIS_LEFT, b & GENESIS_RIGHT);
+	OLD_BUTTON(square_btn, square_axis, b & GENESIS_A);
+	OLD_BUTTON(cross_btn, cross_axis, b & GENESIS_B);
+	OLD_BUTTON(circle_btn, circle_axis, b & GENESIS_C);
+	OLD_BUTTON(l1_btn, l1_axis, b & GENESIS_X);
+	OLD_BUTTON(triangle_btn, triangle_axis, b & GENESIS_Y);
+	OLD_BUTTON(r1_btn, r1_axis, b & GENESIS_Z);
+	s->select_btn = (b & GENESIS_MODE) > 0;
+	s->start_btn = (b & GENESIS_START) > 0;
+	s->ps_btn = (b & GENESIS_UP) && (b & GENESIS_START);
+}
+
+static void old_arcade(uint16_t b, gamepad_state_t *s) {
+	old_axes(s, b & 0x01, b & 0x02, b & 0x04, b & 0x08);
+	OLD_BUTTON(square_btn, square_axis, b & 0x10);
+	OLD_BUTTON(cross_btn, cross_axis, b & 0x20);
+	OLD_BUTTON(triangle_btn, triangle_axis, b & 0x40);
+	OLD_BUTTON(circle_btn, circle_axis, b & 0x80);
+	OLD_BUTTON(l1_btn, l1_axis, b & 0x100);
+	OLD_BUTTON(r1_btn, r1_axis, b & 0x200);
+	OLD_BUTTON(l2_btn, l2_axis, b & 0x400);
+	OLD_BUTTON(r2_btn, r2_axis, b & 0x800);
+	s->select_btn = (b & 0x1000) > 0;
+	s->start_btn = (b & 0x2000) > 0;
+	s->l3_btn = (b & 0x4000) > 0;
+	s->ps_btn = (b & 0x8000) > 0;
+}
+
+static void old_nes(uint16_t b, gamepad_state_t *s) {
+	old_axes(s, b & 16, b & 32, b & 64, b & 128);
+	OLD_BUTTON(square_btn, square_axis, b & 2);
+	OLD_BUTTON(cross_btn, cross_axis, b & 1);
+	s->select_btn = (b & 4) > 0;
+	s->start_btn = (b & 8) > 0;
+	s->ps_btn = (b & 4) && (b & 8);
+}
+
+static void old_snes(uint16_t b, gamepad_state_t *s) {
+	old_axes(s, b & 16, b & 32, b & 64, b & 128);
+	OLD_BUTTON(square_btn, square_axis, b & 2);
+	OLD_BUTTON(cross_btn, cross_axis, b & 1);
+	OLD_BUTTON(circle_btn, circle_axis, b & 256);
+	OLD_BUTTON(l1_btn, l1_axis, b & 1024);
+	OLD_BUTTON(triangle_btn, triangle_axis, b & 512);
+	OLD_BUTTON(r1_btn, r1_axis, b & 2048);
+	s->select_btn = (b & 4) > 0;
+	s->start_btn = (b & 8) > 0;
+	s->ps_btn = (b & 4) && (b & 8);
+}
+
+static void old_neogeo(uint16_t b, gamepad_state_t *s) {
+	old_axes(s, b & 0x04, b & 0x1000, b & 0x02, b & 0x800);
+	OLD_BUTTON(square_btn, square_axis, b & 0x8000);
+	OLD_BUTTON(cross_btn, cross_axis, b & 0x01);
+	OLD_BUTTON(circle_btn, circle_axis, b & 0x400);
+	OLD_BUTTON(triangle_btn, triangle_axis, b & 0x200);
+	s->select_btn = (b & 0x100) > 0;
+	s->start_btn = (b & 0x4000) > 0;
+	s->ps_btn = (b & 0x100) && (b & 0x4000);
+}
+
+static void old_saturn(uint16_t b, gamepad_state_t *s) {
+	old_axes(s, b & SATURN_UP, b & SATURN_DOWN, b & SATURN_LEFT, b & SATURN_RIGHT);
+	OLD_BUTTON(square_btn, square_axis, b & SATURN_A);
+	OLD_BUTTON(cross_btn, cross_axis, b & SATURN_B);
+	OLD_BUTTON(circle_btn, circle_axis, b & SATURN_C);
+	OLD_BUTTON(l1_btn, l1_axis, b & SATURN_X);
+	OLD_BUTTON(triangle_btn, triangle_axis, b & SATURN_Y);
+	OLD_BUTTON(r1_btn, r1_axis, b & SATURN_Z);
+	OLD_BUTTON(l2_btn, l2_axis, b & SATURN_L);
+	OLD_BUTTON(r2_btn, r2_axis, b & SATURN_R);
+	s->start_btn = (b & SATURN_START) > 0;
+	s->ps_btn = (b & SATURN_UP) && (b & SATURN_START);
+}
+
+static void old_tg16(uint16_t b, gamepad_state_t *s) {
+	old_axes(s, b & (1 << TG16_UP), b & (1 << TG16_DOWN), b & (1 << TG16_LEFT), b & (1 << TG16_RIGHT));
+	OLD_BUTTON(square_btn, square_axis, b & (1 << TG16_II));
+	OLD_BUTTON(cross_btn, cross_axis, b & (1 << TG16_I));
+	s->start_btn = (b & (1 << TG16_RUN)) > 0;
+	s->select_btn = (b & (1 << TG16_SELECT)) > 0;
+	s->ps_btn = s->start_btn && s->select_btn;
+}
+
+// PS2, digital (type 0) or analog; sticks left out
+static void old_ps2(uint16_t b, gamepad_state_t *s, bool analog) {
+	if(!analog) {
+		s->r_x_axis = 0x80;
+		s->r_y_axis = 0x80;
+		old_axes(s, b & PSB_PAD_UP, b & PSB_PAD_DOWN, b & PSB_PAD_LEFT, b & PSB_PAD_RIGHT);
+	} else {
+		s->direction = old_pad_dir[((b & PSB_PAD_UP) > 0) << 3 | ((b & PSB_PAD_DOWN) > 0) << 2 |
+				((b & PSB_PAD_LEFT) > 0) << 1 | ((b & PSB_PAD_RIGHT) > 0)];
+	}
+
+	OLD_BUTTON(square_btn, square_axis, b & PSB_SQUARE);
+	OLD_BUTTON(cross_btn, cross_axis, b & PSB_CROSS);
+	OLD_BUTTON(circle_btn, circle_axis, b & PSB_CIRCLE);
+	OLD_BUTTON(l1_btn, l1_axis, b & PSB_L1);
+	OLD_BUTTON(l2_btn, l2_axis, b & PSB_L2);
+	OLD_BUTTON(triangle_btn, triangle_axis, b & PSB_TRIANGLE);
+	OLD_BUTTON(r1_btn, r1_axis, b & PSB_R1);
+	OLD_BUTTON(r2_btn, r2_axis, b & PSB_R2);
+	s->l3_btn = (b & PSB_L3) > 0;
+	s->r3_btn = (b & PSB_R3) > 0;
+	s->select_btn = (b & PSB_SELECT) > 0;
+	s->start_btn = (b & PSB_START) > 0;
+	s->ps_btn = (b & PSB_SELECT) && (b & PSB_START);
+}
+
+// GC, the raw word is button_data[0] << 8 | button_data[1]; sticks and
+// slider left out
+static void old_gc(uint16_t b, gamepad_state_t *s) {
+	uint8_t b0 = b >> 8, b1 = b;
+
+	s->direction = old_pad_dir[((b1 & 0x08) > 0) << 3 | ((b1 & 0x04) > 0) << 2 | ((b1 & 0x01) > 0) << 1 | ((b1 & 0x02) > 0)];
+	OLD_BUTTON(square_btn, square_axis, b0 & 0x08);
+	OLD_BUTTON(cross_btn, cross_axis, b0 & 0x02);
+	OLD_BUTTON(triangle_btn, triangle_axis, b0 & 0x04);
+	OLD_BUTTON(circle_btn, circle_axis, b0 & 0x01);
+	s->start_btn = (b0 & 0x10) > 0;
+	OLD_BUTTON(l1_btn, l1_axis, b1 & 0x40);
+	OLD_BUTTON(r1_btn, r1_axis, b1 & 0x20);
+	OLD_BUTTON(l2_btn, l2_axis, b1 & 0x10);
+	s->ps_btn = (b1 & 0x08) && (b0 & 0x10);
+}
+
+// N64, same raw word; the left stick left out
+static void old_n64(uint16_t b, gamepad_state_t *s) {
+	uint8_t b0 = b >> 8, b1 = b;
+
+	s->direction = old_pad_dir[((b0 & 0x08) > 0) << 3 | ((b0 & 0x04) > 0) << 2 | ((b0 & 0x02) > 0) << 1 | ((b0 & 0x01) > 0)];
+	OLD_BUTTON(square_btn, square_axis, b0 & 0x40);
+	OLD_BUTTON(cross_btn, cross_axis, b0 & 0x80);
+	s->start_btn = (b0 & 0x10) > 0;
+	OLD_BUTTON(l1_btn, l1_axis, b1 & 0x20);
+	OLD_BUTTON(r1_btn, r1_axis, b1 & 0x10);
+	OLD_BUTTON(l2_btn, l2_axis, b0 & 0x20);
+	s->ps_btn = (b0 & 0x08) && (b0 & 0x10);
+
+	s->r_x_axis = 0x80;
+	s->r_y_axis = 0x80;
+
+	if(b1 & 0x08)
+		s->r_y_axis = 0x00;
+	else if(b1 & 0x04)
+		s->r_y_axis = 0xFF;
+
+	if(b1 & 0x02)
+		s->r_x_axis = 0x00;
+	else if(b1 & 0x01)
+		s->r_x_axis = 0xFF;
+}
+
+// The mapping steps of digital_loop()
+template <class Pad>
+static void new_digital(const padmap_t *map, uint16_t b, gamepad_state_t *s) {
+	dir_to_axes(socd_resolve(padmap_dir(b, Pad::up, Pad::down, Pad::left, Pad::right)),
+			&s->l_x_axis, &s->l_y_axis);
+
+	padmap_apply(map, b, (uint8_t *) s);
+}
+
+// The mapping steps of ps2_loop(), gc_loop() and n64_loop()
+static void new_ps2(uint16_t b, gamepad_state_t *s, bool analog) {
+	byte dir = socd_resolve(padmap_dir(b, PSB_PAD_UP, PSB_PAD_DOWN, PSB_PAD_LEFT, PSB_PAD_RIGHT));
+
+	if(!analog) {
+		s->r_x_axis = 0x80;
+		s->r_y_axis = 0x80;
+
+		dir_to_axes(dir, &s->l_x_axis, &s->l_y_axis);
+	} else {
+		s->direction = pad_dir[dir];
+	}
+
+	padmap_apply(ps2_map, b, (uint8_t *) s);
+}
+
+static void new_gc(uint16_t b, gamepad_state_t *s) {
+	s->direction = pad_dir[socd_resolve(padmap_dir(b, 0x0008, 0x0004, 0x0001, 0x0002))];
+	padmap_apply(gc_map, b, (uint8_t *) s);
+}
+
+static void new_n64(uint16_t b, gamepad_state_t *s) {
+	s->direction = pad_dir[socd_resolve(padmap_dir(b, 0x0800, 0x0400, 0x0200, 0x0100))];
+	padmap_apply(n64_map, b, (uint8_t *) s);
+	dir_to_axes(padmap_dir(b, 0x0008, 0x0004, 0x0002, 0x0001), &s->r_x_axis, &s->r_y_axis);
+}
+
+typedef void (*map_fn)(uint16_t b, gamepad_state_t *s);
+
+// Every raw word, each over reports that start cleared, set and patterned
+static uint32_t mismatches(uint8_t pad, map_fn old_map, map_fn new_map) {
+	static const uint8_t fills[] = { 0x00, 0xFF, 0xA5 };
+	gamepad_state_t want, got;
+	uint32_t bad = 0;
+
+	padmap_load(pad);
+
+	for(uint8_t f = 0; f < sizeof(fills); f++) {
+		for(uint32_t b = 0; b <= 0xFFFF; b++) {
+			memset(&want, fills[f], sizeof(want));
+			memset(&got, fills[f], sizeof(got));
+
+			old_map(b, &want);
+			new_map(b, &got);
+
+			if(memcmp(&want, &got, sizeof(want))) {
+				if(!bad)
+					printf("pad %u, buttons %04X, fill %02X differs\n", pad, (unsigned) b, fills[f]);
+
+				bad++;
+			}
+		}
+	}
+
+	return bad;
+}
+
+static void old_ps2_digital(uint16_t b, gamepad_state_t *s) { old_ps2(b, s, false); }
+static void old_ps2_analog(uint16_t b, gamepad_state_t *s) { old_ps2(b, s, true); }
+static void new_ps2_digital(uint16_t b, gamepad_state_t *s) { new_ps2(b, s, false); }
+static void new_ps2_analog(uint16_t b, gamepad_state_t *s) { new_ps2(b, s, true); }
+
+#define NEW_DIGITAL(name, driver, map) \
+	static void name(uint16_t b, gamepad_state_t *s) { new_digital<driver>(map, b, s); }
+
+NEW_DIGITAL(new_genesis, GenesisDriver, genesis_map)
+NEW_DIGITAL(new_arcade, ArcadeDriver, arcade_map)
+NEW_DIGITAL(new_nes, NESDriver, nes_map)
+NEW_DIGITAL(new_snes, SNESDriver, snes_map)
+NEW_DIGITAL(new_neogeo, NeoGeoDriver, neogeo_map)
+NEW_DIGITAL(new_saturn, SaturnDriver, saturn_map)
+NEW_DIGITAL(new_tg16, TG16Driver, tg16_map)
+
+int main() {
+	memset(test_eeprom, 0xFF, sizeof(test_eeprom));
+
+	CHECK_EQ(mismatches(PADMAP_GENESIS, old_genesis, new_genesis), 0);
+	CHECK_EQ(mismatches(PADMAP_ARCADE, old_arcade, new_arcade), 0);
+	CHECK_EQ(mismatches(PADMAP_NES, old_nes, new_nes), 0);
+	CHECK_EQ(mismatches(PADMAP_SNES, old_snes, new_snes), 0);
+	CHECK_EQ(mismatches(PADMAP_NEOGEO, old_neogeo, new_neogeo), 0);
+	CHECK_EQ(mismatches(PADMAP_SATURN, old_saturn, new_saturn), 0);
+	CHECK_EQ(mismatches(PADMAP_TG16, old_tg16, new_tg16), 0);
+	CHECK_EQ(mismatches(PADMAP_PS2, old_ps2_digital, new_ps2_digital), 0);
+	CHECK_EQ(mismatches(PADMAP_PS2, old_ps2_analog, new_ps2_analog), 0);
+	CHECK_EQ(mismatches(PADMAP_GC, old_gc, new_gc), 0);
+	CHECK_EQ(mismatches(PADMAP_N64, old_n64, new_n64), 0);
+
+	return test_done("maps");
+}
@@ -0,0 +1,52 @@
+/*
+ * genesis, saturn, tg16: the one read per port decoders against reading the
+ * data lines one digitalRead() at a time, as the drivers did before, for
+ * every PIND and PINB value.
+ *
+ * The drivers are included to reach their file local decoders.
+ */
+#include "test.h"
+#include "genesis.cpp"
+#undef DELAY
+#include "saturn.cpp"
+#undef DELAY
+#include "tg16.cpp"
+
+// Active high bits from pins, pressed = low
+static byte pins_low(const byte *pins, byte count) {
+	byte bits = 0;
+
+	for(byte i = 0; i < count; i++) {
+		if(!digitalRead(pins[i]))
+			bits |= 1 << i;
+	}
+
+	return bits;
+}
+
+int main() {
+	static const byte genesis_pins[] = { DB9P1, DB9P2, DB9P3, DB9P4, DB9P6, DB9P9 };
+	static const byte saturn_pins[] = { D0, D1, D2, D3 };
+	static const byte tg16_pins[] = { 5, 7, 8, 9 };
+	unsigned long mismatches[3] = { 0, 0, 0 };
+
+	for(unsigned int ports = 0; ports <= 0xFFFF; ports++) {
+		PIND = ports & 0xFF;
+		PINB = ports >> 8;
+
+		if(genesis_lines() != pins_low(genesis_pins, sizeof(genesis_pins)))
+			mismatches[0]++;
+
+		if(saturn_nibble() != pins_low(saturn_pins, sizeof(saturn_pins)))
+			mismatches[1]++;
+
+		if(tg16_nibble() != pins_low(tg16_pins, sizeof(tg16_pins)))
+			mismatches[2]++;
+	}
+
+	CHECK_EQ(mismatches[0], 0);
+	CHECK_EQ(mismatches[1], 0);
+	CHECK_EQ(mismatches[2], 0);
+
+	return test_done("nibbles");
+}
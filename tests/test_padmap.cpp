@@ -0,0 +1,137 @@
+/*
+ * padmap: the table engine against the rules in padmap.h, and the remap
+ * stage (erased and identity tables change nothing, a remap permutes bits).
+ */
+#include <string.h>
+#include <avr/eeprom.h>
+#include "test.h"
+#include "padmap.h"
+#include "settings.h"
+#include "turbo.h"
+
+// Report bytes 0-1 take buttons, 2 a button as a full scale axis, 3 a combo
+static const PROGMEM padmap_t map[] = {
+	{ 0x0001, 0, 0x01 }, { 0x0002, 0, 0x02 }, { 0x0004, 0, 0x04 }, { 0x0008, 0, 0x08 },
+	{ 0x0010, 0, 0x10 }, { 0x0020, 0, 0x20 }, { 0x0040, 0, 0x40 }, { 0x0080, 0, 0x80 },
+	{ 0x0100, 1, 0x01 }, { 0x0200, 1, 0x02 }, { 0x0400, 1, 0x04 }, { 0x0800, 1, 0x08 },
+	{ 0x1000, 1, 0x10 }, { 0x2000, 1, 0x20 },
+	{ 0x0100, 2, 0xFF },
+	{ 0x4000 | 0x8000, 3, 0x01 },
+	{ 0 }
+};
+
+#define REPORT_SIZE 5
+#define FILL 0x5A
+
+// The engine sets or clears the bits it has entries for and leaves the rest
+// of the report as it was
+static void expected(uint16_t buttons, uint8_t *report) {
+	report[0] = buttons & 0xFF;
+	report[1] = (FILL & 0xC0) | ((buttons >> 8) & 0x3F);
+	report[2] = (buttons & 0x0100) ? 0xFF : 0x00;
+	report[3] = (FILL & ~0x01) | ((buttons & 0xC000) == 0xC000);
+	report[4] = FILL;
+}
+
+static bool apply_matches(uint16_t (*source)(uint16_t)) {
+	uint8_t report[REPORT_SIZE], want[REPORT_SIZE];
+
+	for(uint32_t buttons = 0; buttons <= 0xFFFF; buttons++) {
+		memset(report, FILL, sizeof(report));
+		padmap_apply(map, buttons, report);
+		expected(source(buttons), want);
+
+		if(memcmp(report, want, sizeof(report))) {
+			printf("buttons %04x: got %02x %02x %02x %02x %02x\n", (unsigned) buttons,
+					report[0], report[1], report[2], report[3], report[4]);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static uint16_t same(uint16_t buttons) {
+	return buttons;
+}
+
+// Bits 0 and 15 swapped, bit 1 takes bit 2
+static uint16_t swapped(uint16_t buttons) {
+	uint16_t out = buttons & ~0x8003;
+
+	if(buttons & 0x8000)
+		out |= 0x0001;
+	if(buttons & 0x0001)
+		out |= 0x8000;
+	if(buttons & 0x0004)
+		out |= 0x0002;
+
+	return out;
+}
+
+// Queues a table and runs the deferred writer until it's in
+static void store(uint8_t pad, const uint8_t *source) {
+	CHECK(padmap_store(pad, source));
+
+	// A second store waits for the first one
+	CHECK(!padmap_store(pad, source));
+
+	for(int i = 0; i < 64; i++)
+		settings_task();
+}
+
+int main() {
+	uint8_t source[16];
+
+	memset(test_eeprom, 0xFF, sizeof(test_eeprom));
+
+	// Erased EEPROM: no remap
+	padmap_load(PADMAP_SNES);
+	CHECK_EQ(padmap_current(), PADMAP_SNES);
+
+	for(uint8_t i = 0; i < 16; i++)
+		CHECK_EQ(padmap_source(i), i);
+
+	CHECK(apply_matches(same));
+
+	// An explicit identity table is the same as none
+	for(uint8_t i = 0; i < 16; i++)
+		source[i] = i;
+
+	store(PADMAP_SNES, source);
+	CHECK(apply_matches(same));
+
+	// A remap of the pad in use applies once it's in EEPROM
+	source[0] = 15;
+	source[15] = 0;
+	source[1] = 2;
+	store(PADMAP_SNES, source);
+
+	padmap_read(PADMAP_SNES, source);
+	CHECK_EQ(source[0], 15);
+	CHECK_EQ(padmap_source(0), 15);
+	CHECK_EQ(padmap_source(15), 0);
+	CHECK_EQ(padmap_source(1), 2);
+	CHECK(apply_matches(swapped));
+
+	// Other pads keep their own table
+	padmap_load(PADMAP_NES);
+	CHECK(apply_matches(same));
+
+	// Out of range entries read as unchanged
+	memset(test_eeprom + EE_REMAP + PADMAP_NES * 16, 0x40, 16);
+	padmap_load(PADMAP_NES);
+	CHECK(apply_matches(same));
+
+	// Turbo's off phase releases the button after the remap
+	padmap_load(PADMAP_SNES);
+	turbo_mask = ~0x0001;
+	uint8_t report[REPORT_SIZE] = { 0 };
+	padmap_apply(map, 0x8000, report);
+	CHECK_EQ(report[0] & 0x01, 0);
+	turbo_mask = 0xFFFF;
+	padmap_apply(map, 0x8000, report);
+	CHECK_EQ(report[0] & 0x01, 0x01);
+
+	return test_done("padmap");
+}
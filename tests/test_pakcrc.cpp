@@ -0,0 +1,79 @@
+/*
+ * pakcrc: the N64 pak address and data checksums against plain polynomial
+ * division, and the address values the rumble pak is known to answer to.
+ */
+#include <string.h>
+#include <stdlib.h>
+#include "test.h"
+#include "pakcrc.h"
+
+// Remainder of address bits 15-5, times x^5, divided by x^5 + x^4 + x^2 + 1
+static uint8_t address_crc(uint16_t address) {
+	uint32_t value = (uint32_t) (address >> 5) << 5;
+
+	for(int bit = 15; bit >= 5; bit--) {
+		if(value & (1UL << bit))
+			value ^= 0x35UL << (bit - 5);
+	}
+
+	return value;
+}
+
+// CRC-8, polynomial 0x85, MSB first, no initial or final XOR
+static uint8_t data_crc(const uint8_t *data) {
+	uint8_t crc = 0;
+
+	for(int i = 0; i < 32; i++) {
+		crc ^= data[i];
+
+		for(int bit = 0; bit < 8; bit++)
+			crc = (crc & 0x80) ? (crc << 1) ^ 0x85 : crc << 1;
+	}
+
+	return crc;
+}
+
+int main() {
+	uint8_t block[32];
+	unsigned long mismatches = 0;
+
+	// Rumble pak: probed at 0x8000, motor at 0xC000
+	CHECK_EQ(pak_address(0x0000), 0x0000);
+	CHECK_EQ(pak_address(0x8000), 0x8001);
+	CHECK_EQ(pak_address(0xC000), 0xC01B);
+
+	// Every address, with whatever was in the CRC bits
+	for(uint32_t address = 0; address <= 0xFFFF; address++) {
+		if(pak_address(address) != ((address & 0xFFE0) | address_crc(address)))
+			mismatches++;
+	}
+
+	CHECK_EQ(mismatches, 0);
+
+	// Blocks of one value, then random ones
+	mismatches = 0;
+
+	for(int value = 0; value <= 0xFF; value++) {
+		memset(block, value, sizeof(block));
+
+		if(pak_data_crc(block) != data_crc(block))
+			mismatches++;
+	}
+
+	srand(1);
+
+	for(int i = 0; i < 10000; i++) {
+		for(int j = 0; j < 32; j++)
+			block[j] = rand();
+
+		if(pak_data_crc(block) != data_crc(block))
+			mismatches++;
+	}
+
+	CHECK_EQ(mismatches, 0);
+
+	memset(block, 0, sizeof(block));
+	CHECK_EQ(pak_data_crc(block), 0x00);
+
+	return test_done("pakcrc");
+}
@@ -0,0 +1,138 @@
+/*
+ * PS2Pad: polls stop at the frame length the pad announces in its mode
+ * byte, replayed against canned 0x41, 0x73 and 0x79 replies.
+ *
+ * The driver is included to reach its file local frame_length().
+ */
+#include <string.h>
+#include "test.h"
+#include "PS2Pad.cpp"
+
+/*
+ * Pad on ATT 7, CLK 8, CMD 6 and DAT 5. It shifts a reply byte out LSB first
+ * on falling CLK and samples CMD on rising CLK, while ATT is low. Every
+ * command is answered with the canned reply: 0xFF, mode, 0x5A, data.
+ */
+static struct {
+	uint8_t reply[21];
+	uint8_t command[21];
+	uint8_t bytes, bits;
+	uint8_t att, clk;
+} pad;
+
+static void pad_bit() {
+	uint8_t bit = pad.bytes < sizeof(pad.reply) ? (pad.reply[pad.bytes] >> pad.bits) & 1 : 1;
+
+	gpio_in[DAT_PIN] = bit;
+}
+
+static void ps2_pad(uint8_t pin, uint8_t level) {
+	if(pin == ATT_PIN) {
+		if(!level && pad.att) {
+			pad.bytes = pad.bits = 0;
+			memset(pad.command, 0, sizeof(pad.command));
+		}
+
+		pad.att = level;
+	} else if(pin == CLK_PIN && !pad.att && level != pad.clk) {
+		if(!level) {
+			pad_bit();
+		} else {
+			if(gpio_level(CMD_PIN) && pad.bytes < sizeof(pad.command))
+				pad.command[pad.bytes] |= 1 << pad.bits;
+
+			if(++pad.bits == 8) {
+				pad.bits = 0;
+				pad.bytes++;
+			}
+		}
+	}
+
+	if(pin == CLK_PIN)
+		pad.clk = level;
+}
+
+static void replay(const uint8_t *reply, uint8_t length) {
+	memset(pad.reply, 0xFF, sizeof(pad.reply));
+	memcpy(pad.reply, reply, length);
+
+	PS2Pad::read();
+}
+
+int main() {
+	// Digital: two button bytes
+	static const uint8_t digital[] = { 0xFF, 0x41, 0x5A, 0xF7, 0x5F };
+
+	// Analog: buttons and four stick bytes
+	static const uint8_t analog[] = { 0xFF, 0x73, 0x5A, 0xFF, 0x7F, 0x10, 0x20, 0x80, 0xF0 };
+
+	// DualShock 2 pressures: the analog frame and 12 pressure bytes
+	static const uint8_t pressures[] = {
+		0xFF, 0x79, 0x5A, 0xFF, 0xBF, 0x11, 0x22, 0x33, 0x44,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00
+	};
+
+	CHECK_EQ(frame_length(0x41), 5);
+	CHECK_EQ(frame_length(0x73), 9);
+	CHECK_EQ(frame_length(0x79), 21);
+	CHECK_EQ(frame_length(0xF3), 9);
+	CHECK_EQ(frame_length(0x70), 21);
+
+	gpio_reset();
+	pad.att = pad.clk = 1;
+	gpio_pad = ps2_pad;
+
+	pinModeFast(DAT_PIN, INPUT);
+	pinModeFast(CLK_PIN, OUTPUT);
+	pinModeFast(ATT_PIN, OUTPUT);
+	pinModeFast(CMD_PIN, OUTPUT);
+	digitalWriteFast(CLK_PIN, HIGH);
+	digitalWriteFast(ATT_PIN, HIGH);
+
+	// Only the announced bytes are clocked, the rest read as the idle bus
+	replay(digital, sizeof(digital));
+	CHECK_EQ(pad.bytes, 5);
+	CHECK(!PS2Pad::pressures());
+	CHECK_EQ(PS2Pad::psx_buttons(), PSB_START | PSB_SQUARE | PSB_CIRCLE);
+	CHECK_EQ(PS2Pad::stick(PSS_RX), 0xFF);
+	CHECK_EQ(PS2Pad::stick(PSS_LY), 0xFF);
+
+	for(uint8_t i = 5; i < 21; i++)
+		CHECK_EQ(PS2Pad::pressure(i), 0xFF);
+
+	replay(analog, sizeof(analog));
+	CHECK_EQ(pad.bytes, 9);
+	CHECK_EQ(PS2Pad::psx_buttons(), PSB_SQUARE);
+	CHECK_EQ(PS2Pad::stick(PSS_RX), 0x10);
+	CHECK_EQ(PS2Pad::stick(PSS_RY), 0x20);
+	CHECK_EQ(PS2Pad::stick(PSS_LX), 0x80);
+	CHECK_EQ(PS2Pad::stick(PSS_LY), 0xF0);
+
+	for(uint8_t i = 9; i < 21; i++)
+		CHECK_EQ(PS2Pad::pressure(i), 0xFF);
+
+	replay(pressures, sizeof(pressures));
+	CHECK_EQ(pad.bytes, 21);
+	CHECK(PS2Pad::pressures());
+	CHECK_EQ(PS2Pad::psx_buttons(), PSB_CROSS);
+	CHECK_EQ(PS2Pad::stick(PSS_LY), 0x44);
+	CHECK_EQ(PS2Pad::pressure(PSAB_CROSS), 0xC0);
+	CHECK_EQ(PS2Pad::pressure(PSAB_R2), 0x00);
+
+	// Going back to a shorter frame clears the bytes the longer one left
+	replay(digital, sizeof(digital));
+	CHECK_EQ(pad.bytes, 5);
+	CHECK_EQ(PS2Pad::pressure(PSAB_CROSS), 0xFF);
+	CHECK_EQ(PS2Pad::stick(PSS_LY), 0xFF);
+
+	// The poll command carries the motor values in bytes 3 and 4
+	PS2Pad::rumble(1, 0x80);
+	replay(analog, sizeof(analog));
+	CHECK_EQ(pad.command[0], 0x01);
+	CHECK_EQ(pad.command[1], 0x42);
+	CHECK_EQ(pad.command[3], 0xFF);
+	CHECK_EQ(pad.command[4], 0x80);
+	CHECK_EQ(gpio_level(ATT_PIN), HIGH);
+
+	return test_done("ps2frame");
+}
@@ -0,0 +1,110 @@
+/*
+ * socd: every transition between two direction nibbles, in each mode.
+ */
+#include <string.h>
+#include <avr/eeprom.h>
+#include "test.h"
+#include "socd.h"
+#include "padmap.h"
+#include "settings.h"
+
+#define UD	(PADMAP_UP | PADMAP_DOWN)
+#define LR	(PADMAP_LEFT | PADMAP_RIGHT)
+
+static void store(uint8_t pad, uint8_t mode) {
+	CHECK(socd_store(pad, mode));
+
+	for(int i = 0; i < 4; i++)
+		settings_task();
+}
+
+// What one axis of 'to' resolves to after 'from', worked out per mode
+static uint8_t expected(uint8_t mode, uint8_t axis, uint8_t from, uint8_t to) {
+	uint8_t pressed = axis & ~from;
+
+	if((to & axis) != axis)
+		return to & axis;
+
+	switch(mode) {
+	case SOCD_LAST_WINS:
+		// Both pressed at once, or both already held from the first sample
+		if(pressed == axis || !pressed)
+			return 0;
+
+		return pressed;
+	case SOCD_UP_PRIORITY:
+		return axis == UD ? PADMAP_UP : 0;
+	default:
+		return 0;
+	}
+}
+
+int main() {
+	const uint8_t modes[] = { SOCD_NEUTRAL, SOCD_LAST_WINS, SOCD_UP_PRIORITY };
+	uint8_t m, from, to, out;
+
+	memset(test_eeprom, 0xFF, sizeof(test_eeprom));
+
+	// Erased and invalid entries are off and pass opposing directions
+	CHECK_EQ(socd_read(0), SOCD_OFF);
+	socd_load(0);
+	CHECK_EQ(socd_resolve(UD | LR), UD | LR);
+
+	store(0, 3);
+	CHECK_EQ(socd_read(0), SOCD_OFF);
+
+	for(m = 0; m < sizeof(modes); m++) {
+		store(0, modes[m]);
+		CHECK_EQ(socd_read(0), modes[m]);
+
+		for(from = 0; from < 16; from++) {
+			for(to = 0; to < 16; to++) {
+				socd_load(0);
+				socd_resolve(from);
+				out = socd_resolve(to);
+
+				// Never both directions of an axis, never one not held
+				CHECK((out & UD) != UD && (out & LR) != LR);
+				CHECK_EQ(out & ~to, 0);
+
+				CHECK_EQ(out & UD, expected(modes[m], UD, from, to));
+				CHECK_EQ(out & LR, expected(modes[m], LR, from, to));
+			}
+		}
+	}
+
+	// Last wins follows the most recent press while both stay held, and
+	// gives the axis back to the other direction on release
+	store(0, SOCD_LAST_WINS);
+	socd_load(0);
+	CHECK_EQ(socd_resolve(PADMAP_LEFT), PADMAP_LEFT);
+	CHECK_EQ(socd_resolve(LR), PADMAP_RIGHT);
+	CHECK_EQ(socd_resolve(LR), PADMAP_RIGHT);
+	CHECK_EQ(socd_resolve(PADMAP_LEFT), PADMAP_LEFT);
+	CHECK_EQ(socd_resolve(LR), PADMAP_RIGHT);
+	CHECK_EQ(socd_resolve(PADMAP_RIGHT), PADMAP_RIGHT);
+	CHECK_EQ(socd_resolve(LR), PADMAP_LEFT);
+	CHECK_EQ(socd_resolve(LR | PADMAP_UP), PADMAP_LEFT | PADMAP_UP);
+	CHECK_EQ(socd_resolve(LR | UD), PADMAP_LEFT | PADMAP_DOWN);
+
+	// Each player keeps its own history
+	socd_load(0);
+	CHECK_EQ(socd_resolve(PADMAP_LEFT, 0), PADMAP_LEFT);
+	CHECK_EQ(socd_resolve(PADMAP_RIGHT, 1), PADMAP_RIGHT);
+	CHECK_EQ(socd_resolve(LR, 0), PADMAP_RIGHT);
+	CHECK_EQ(socd_resolve(LR, 1), PADMAP_LEFT);
+	CHECK_EQ(socd_resolve(LR, SOCD_PLAYERS - 1), 0);
+
+	// Modes are per pad, storing another pad leaves the loaded one alone
+	store(1, SOCD_NEUTRAL);
+	CHECK_EQ(socd_read(0), SOCD_LAST_WINS);
+	CHECK_EQ(socd_read(1), SOCD_NEUTRAL);
+	CHECK_EQ(socd_resolve(PADMAP_LEFT), PADMAP_LEFT);
+	CHECK_EQ(socd_resolve(LR), PADMAP_RIGHT);
+
+	// Storing the loaded pad switches it once the byte is in
+	store(0, SOCD_OFF);
+	CHECK_EQ(socd_resolve(UD | LR), UD | LR);
+
+	return test_done("socd");
+}
@@ -0,0 +1,193 @@
+/*
+ * stickmap: the response tables built from EEPROM settings, per axis and
+ * radial.
+ */
+#include <math.h>
+#include <string.h>
+#include <avr/eeprom.h>
+#include "test.h"
+#include "stickmap.h"
+#include "settings.h"
+
+static void configure(uint8_t flags, uint8_t deadzone, uint8_t anti_deadzone) {
+	stickmap_config_t config = { flags, deadzone, anti_deadzone, 0 };
+
+	memset(test_eeprom, 0xFF, sizeof(test_eeprom));
+	memcpy(test_eeprom + EE_STICKMAP + STICKMAP_GC * 2 * sizeof(config), &config, sizeof(config));
+	stickmap_init(STICKMAP_GC);
+}
+
+static uint8_t axis(uint8_t value) {
+	uint8_t x = value, y = 0x80;
+
+	stickmap_apply(STICKMAP_LEFT, &x, &y);
+	return x;
+}
+
+static int distance(int x, int y) {
+	x = abs(x - 0x80);
+	y = abs(y - 0x80);
+
+	return (x > y) ? x + y / 2 : y + x / 2;
+}
+
+// Checks that an axis is monotonic, centred at rest and reaches both ends
+static void check_axis_shape() {
+	for(int v = 1; v <= 255; v++)
+		CHECK(axis(v) >= axis(v - 1));
+
+	CHECK_EQ(axis(0x80), 0x80);
+	CHECK_EQ(axis(0x00), 0x00);
+	CHECK_EQ(axis(0xFF), 0xFF);
+}
+
+int main() {
+	// Erased EEPROM and invalid settings: both sticks pass through
+	memset(test_eeprom, 0xFF, sizeof(test_eeprom));
+	stickmap_init(STICKMAP_PS2);
+
+	for(int x = 0; x <= 255; x++) {
+		for(int y = 0; y <= 255; y++) {
+			uint8_t ox = x, oy = y;
+
+			stickmap_apply(STICKMAP_RIGHT, &ox, &oy);
+
+			if(ox != x || oy != y) {
+				CHECK_EQ(ox, x);
+				CHECK_EQ(oy, y);
+				x = y = 256;
+			}
+		}
+	}
+
+	configure(0, 200, 0);
+	CHECK_EQ(axis(0x20), 0x20);
+
+	// Axial dead zone and anti-dead zone
+	configure(0, 16, 40);
+	check_axis_shape();
+
+	for(int d = 0; d <= 16; d++) {
+		CHECK_EQ(axis(0x80 + d), 0x80);
+		CHECK_EQ(axis(0x80 - d), 0x80);
+	}
+
+	CHECK(axis(0x80 + 17) >= 0x80 + 40);
+	CHECK(axis(0x80 - 17) <= 0x80 - 40);
+
+	// Exponential curve: below the linear one, same ends
+	configure(0, 0, 0);
+	uint8_t linear[256];
+
+	for(int v = 0; v <= 255; v++)
+		linear[v] = axis(v);
+
+	configure(STICKMAP_EXPONENTIAL, 0, 0);
+	check_axis_shape();
+
+	for(int v = 0x80; v <= 255; v++)
+		CHECK(axis(v) <= linear[v]);
+
+	for(int v = 0; v < 0x80; v++)
+		CHECK(axis(v) >= linear[v]);
+
+	// Radial: one dead zone for the stick, direction kept past it
+	configure(STICKMAP_RADIAL, 20, 40);
+
+	double worst = 0;
+
+	for(int x = 0; x <= 255; x++) {
+		for(int y = 0; y <= 255; y++) {
+			uint8_t ox = x, oy = y;
+
+			stickmap_apply(STICKMAP_LEFT, &ox, &oy);
+
+			if(distance(x, y) <= 20) {
+				CHECK(ox == 0x80 && oy == 0x80);
+				continue;
+			}
+
+			// Just past the dead zone the stick jumps to the anti-dead zone
+			CHECK(distance(ox, oy) >= 40 - 2);
+
+			if(distance(ox, oy) > 8) {
+				double error = fabs(atan2(y - 0x80, x - 0x80) - atan2(oy - 0x80, ox - 0x80));
+
+				if(error > M_PI)
+					error = 2 * M_PI - error;
+				if(error > worst)
+					worst = error;
+			}
+		}
+	}
+
+	CHECK(worst * 180 / M_PI < 2);
+
+	// Full travel and the corners of a square gate keep their full range
+	uint8_t x = 0xFF, y = 0x80;
+	stickmap_apply(STICKMAP_LEFT, &x, &y);
+	CHECK(x == 0xFF && y == 0x80);
+
+	x = 0x00;
+	y = 0x00;
+	stickmap_apply(STICKMAP_LEFT, &x, &y);
+	CHECK(x == 0x00 && y == 0x00);
+
+	x = 0xFF;
+	y = 0xFF;
+	stickmap_apply(STICKMAP_LEFT, &x, &y);
+	CHECK(x == 0xFF && y == 0xFF);
+
+	// Across the settings, the radial scale puts each axis within a step of
+	// offset * out / distance, on its own side of centre
+	for(int flags = STICKMAP_RADIAL; flags <= (STICKMAP_RADIAL | STICKMAP_EXPONENTIAL); flags++) {
+		for(int deadzone = 0; deadzone <= 127; deadzone += 9) {
+			for(int anti = 0; anti <= 127; anti += 9) {
+				int bad = 0;
+
+				configure(flags, deadzone, anti);
+
+				for(int x = 0; x <= 255 && !bad; x++) {
+					for(int y = 0; y <= 255; y++) {
+						int d = distance(x, y) > 128 ? 128 : distance(x, y);
+						int out = 0, position;
+						uint8_t ox = x, oy = y;
+
+						stickmap_apply(STICKMAP_LEFT, &ox, &oy);
+
+						if(d > deadzone) {
+							position = ((d - deadzone) * 128 + 127 - deadzone) / (128 - deadzone);
+
+							if(flags & STICKMAP_EXPONENTIAL)
+								position = (position * position + 127) / 128;
+
+							out = anti + (position * (128 - anti) + 127) / 128;
+						}
+
+						for(int axis = 0; axis < 2; axis++) {
+							int value = axis ? y : x, got = axis ? oy : ox;
+							int offset = abs(value - 0x80);
+							int exact = out ? offset * out / d : 0;
+							int moved = value < 0x80 ? 0x80 - got : got - 0x80;
+
+							if(value >= 0x80 && exact > 0x7F)
+								exact = 0x7F;
+
+							if(moved < 0 || abs(moved - exact) > 1) {
+								printf("flags %d dead %d anti %d: (%d, %d) -> (%d, %d)\n", flags, deadzone, anti, x, y, ox, oy);
+								bad = 1;
+								test_failures++;
+								break;
+							}
+						}
+
+						if(bad)
+							break;
+					}
+				}
+			}
+		}
+	}
+
+	return test_done("stickmap");
+}
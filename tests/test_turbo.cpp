@@ -0,0 +1,88 @@
+/*
+ * turbo: half periods per rate, read from the timer ticks a held button
+ * takes to flip, and the restart in the "pressed" half on every press.
+ */
+#include <string.h>
+#include <avr/eeprom.h>
+#include "test.h"
+#include "turbo.h"
+#include "padmap.h"
+#include "settings.h"
+
+// The Timer2 compare interrupt, a plain function under the stub's ISR()
+void TIMER2_COMPA_vect();
+
+static void load(uint8_t bit, uint8_t rate) {
+	memset(test_eeprom + EE_TURBO, 0xFF, 16);
+	test_eeprom[EE_TURBO + bit] = rate;
+	turbo_load(0);
+}
+
+// Ticks until buttons reads as 'state', 0 if it doesn't within a second
+static int ticks_until(uint16_t buttons, uint16_t state) {
+	for(int ticks = 1; ticks <= TURBO_TICK_HZ; ticks++) {
+		TIMER2_COMPA_vect();
+
+		if(turbo_buttons(buttons) == state)
+			return ticks;
+	}
+
+	return 0;
+}
+
+int main() {
+	memset(test_eeprom, 0xFF, sizeof(test_eeprom));
+
+	// Out of range rates read as off and leave the timer stopped
+	load(0, TURBO_MIN_HZ - 1);
+	CHECK_EQ(TIMSK2, 0);
+	CHECK_EQ(ticks_until(0x0001, 0), 0);
+
+	load(0, TURBO_MAX_HZ + 1);
+	CHECK_EQ(TIMSK2, 0);
+
+	// Each half period is TURBO_TICK_HZ / (2 * rate) ticks, rounded
+	for(uint8_t rate = TURBO_MIN_HZ; rate <= TURBO_MAX_HZ; rate++) {
+		int half = (TURBO_TICK_HZ + rate) / (2 * rate);
+
+		load(3, rate);
+		CHECK(TIMSK2 != 0);
+
+		CHECK_EQ(turbo_buttons(0x0008), 0x0008);
+		CHECK_EQ(ticks_until(0x0008, 0), half);
+		CHECK_EQ(ticks_until(0x0008, 0x0008), half);
+		turbo_buttons(0);
+	}
+
+	// Other buttons pass through untouched
+	load(3, 10);
+	CHECK_EQ(turbo_buttons(0x8001), 0x8001);
+	CHECK_EQ(ticks_until(0x8001, 0), 0);
+	turbo_buttons(0);
+
+	// Released in the "released" half, pressed again: fires at once and
+	// holds for a full half period
+	load(3, 10);
+	turbo_buttons(0x0008);
+	CHECK_EQ(ticks_until(0x0008, 0), 12);
+	CHECK_EQ(turbo_buttons(0), 0);
+	CHECK_EQ(turbo_buttons(0x0008), 0x0008);
+	CHECK_EQ(ticks_until(0x0008, 0), 12);
+
+	// Released part way into the "pressed" half, the timer running on while
+	// it's up: the next press gets the whole half again
+	CHECK_EQ(ticks_until(0x0008, 0x0008), 12);
+
+	for(int i = 0; i < 5; i++)
+		TIMER2_COMPA_vect();
+
+	turbo_buttons(0);
+
+	for(int i = 0; i < 100; i++)
+		TIMER2_COMPA_vect();
+
+	CHECK_EQ(turbo_buttons(0x0008), 0x0008);
+	CHECK_EQ(ticks_until(0x0008, 0), 12);
+
+	return test_done("turbo");
+}
@@ -0,0 +1,469 @@
+/*
+ * USBVirtuaStick: the report descriptor of the build, and how reports reach
+ * the interrupt endpoint: a snapshot per report split in 8 byte packets,
+ * reports skipped while nothing changes until the SET_IDLE period (4ms
+ * units) runs out, and players taking turns. Built once per descriptor
+ * variant (see the Makefile). The settings feature reports and the rumble
+ * output report go through usbFunctionSetup() and usbFunctionWrite() as the
+ * host would send them.
+ *
+ * The module is included to reach its snapshots and helpers. The V-USB
+ * driver is replaced by a model of the interrupt endpoint: a packet queued
+ * with usbSetInterrupt() sits there until host_poll() fetches it.
+ */
+#include <string.h>
+#include <avr/eeprom.h>
+#include "test.h"
+#include "USBVirtuaStick.cpp"
+
+usbTxStatus_t usbTxStatus1;
+uchar *usbMsgPtr;
+
+// The last packets fetched, fetched counts them all
+static struct {
+	uchar data[8];
+	uchar len;
+} packets[64];
+static int fetched;
+
+#define PACKET(n) packets[(n) % 64]
+static bool host_polling, ticking;
+
+// Report ID byte ahead of each report in the multi-player builds
+#define ID_SIZE (VS_PLAYERS > 1)
+
+void usbInit() {}
+
+// The host polls on every usbPoll() once host_polling is set. With ticking
+// set time moves on too, so the waits can give up.
+void usbPoll() {
+	if(ticking)
+		TCNT1++;
+
+	if(host_polling && !usbInterruptIsReady()) {
+		memcpy(PACKET(fetched).data, usbTxBuf1, 8);
+		PACKET(fetched).len = usbTxLen1 - 4;
+		fetched++;
+		usbTxLen1 = USBPID_NAK;
+	}
+}
+
+void usbSetInterrupt(uchar *data, uchar len) {
+	CHECK(usbInterruptIsReady());
+	CHECK(len <= 8);
+
+	memcpy(usbTxBuf1, data, len);
+	usbTxLen1 = len + 4;
+}
+
+// Fetches the queued packet, if any
+static bool host_poll() {
+	int before = fetched;
+	bool polling = host_polling;
+
+	host_polling = true;
+	usbPoll();
+	host_polling = polling;
+
+	return fetched > before;
+}
+
+// Filled in by field: usbWord_t is wider than 2 bytes on the host
+static usbMsgLen_t setup(uchar type, uchar request, uchar value_low, uchar value_high, uchar length) {
+	usbRequest_t rq;
+
+	memset(&rq, 0, sizeof(rq));
+	rq.bmRequestType = type;
+	rq.bRequest = request;
+	rq.wValue.bytes[0] = value_low;
+	rq.wValue.bytes[1] = value_high;
+	rq.wLength.bytes[0] = length;
+
+	return usbFunctionSetup((uchar *) &rq);
+}
+
+static void set_idle(uchar rate) {
+	setup(USBRQ_TYPE_CLASS, USBRQ_HID_SET_IDLE, 0, rate, 0);
+}
+
+// Sends a whole report and gives its bytes, 0 if there was none
+static int send_report(uchar *report) {
+	int first = fetched, size = 0;
+
+	do {
+		vs_send_pad_state();
+
+		if(!host_poll())
+			break;
+
+		memcpy(report + size, PACKET(fetched - 1).data, PACKET(fetched - 1).len);
+		size += PACKET(fetched - 1).len;
+	} while(tx_offset);
+
+	CHECK(fetched - first <= (size + 7) / 8);
+	return size;
+}
+
+// Sends reports until none is due, gives how many went out (stopping at a
+// few more than the players, which can only mean one keeps being due)
+static int drain() {
+	uchar report[64];
+	int reports = 0;
+
+	while(reports < 2 * VS_PLAYERS + 2 && send_report(report))
+		reports++;
+
+	return reports;
+}
+
+// Bits of each report ID declared for each main item type, from the global
+// REPORT_SIZE, REPORT_COUNT and REPORT_ID items in force
+static struct {
+	unsigned int input, output, feature;
+} declared[0x20];
+
+static void walk_descriptor() {
+	unsigned int i = 0, size = 0, count = 0, id = 0;
+	int depth = 0;
+
+	memset(declared, 0, sizeof(declared));
+
+	while(i < sizeof(usbHidReportDescriptor)) {
+		uchar prefix = pgm_read_byte(&usbHidReportDescriptor[i]);
+		uchar length = (prefix & 3) == 3 ? 4 : prefix & 3;
+		uchar data = length ? pgm_read_byte(&usbHidReportDescriptor[i + 1]) : 0;
+
+		switch(prefix & 0xFC) {
+		case 0x74: size = data; break;
+		case 0x94: count = data; break;
+		case 0x84: id = data; CHECK(id && id < 0x20); break;
+		case 0x80: declared[id].input += size * count; break;
+		case 0x90: declared[id].output += size * count; break;
+		case 0xB0: declared[id].feature += size * count; break;
+		case 0xA0: depth++; break;
+		case 0xC0: depth--; CHECK(depth >= 0); break;
+		}
+
+		i += 1 + length;
+	}
+
+	// The last item ends the array and closes the application collection
+	CHECK_EQ(i, USB_CFG_HID_REPORT_DESCRIPTOR_LENGTH);
+	CHECK(USB_CFG_HID_REPORT_DESCRIPTOR_LENGTH <= 254);
+	CHECK_EQ(pgm_read_byte(&usbHidReportDescriptor[i - 1]), 0xC0);
+	CHECK_EQ(depth, 0);
+}
+
+static void check_descriptor() {
+	walk_descriptor();
+
+#if VS_PLAYERS > 1
+	CHECK_EQ(declared[0].input + declared[0].output + declared[0].feature, 0);
+	CHECK_EQ(declared[1].input, VS_REPORT_SIZE * 8);
+	CHECK_EQ(declared[1].output, 5 * 8);
+
+	for(uchar player = 1; player < VS_PLAYERS; player++) {
+		CHECK_EQ(declared[1 + player].input, VS_PLAYER_REPORT_SIZE * 8);
+		CHECK_EQ(declared[1 + player].output, 0);
+	}
+
+	for(uchar id = VS_REMAP_REPORT; id <= VS_SOCD_REPORT; id++)
+		CHECK_EQ(declared[id].feature, USB_CFG_SETTINGS_DESCRIPTOR_LENGTH ? (VS_SETTINGS_REPORT_SIZE - 1) * 8 : 0);
+#else
+	// No report IDs: everything is report 0
+	CHECK_EQ(declared[0].input, VS_REPORT_SIZE * 8);
+#if USB_CFG_COMPACT_REPORT
+	CHECK_EQ(declared[0].output, 6 * 8);
+	CHECK_EQ(declared[0].feature, 0);
+#else
+	CHECK_EQ(declared[0].output, 0);
+	CHECK_EQ(declared[0].feature, 8 * 8);
+#endif
+#endif
+}
+
+static void check_reports() {
+	uchar report[64], want[sizeof(gamepad_state_t)];
+	int size;
+
+	// The first report goes out without a change, one packet per poll
+	vs_send_pad_state();
+	vs_send_pad_state();
+	CHECK(!usbInterruptIsReady());
+	CHECK(host_poll());
+	CHECK_EQ(PACKET(fetched - 1).len, tx_size > 8 ? 8 : tx_size);
+
+	// Later packets come from the snapshot taken for the first
+	memcpy(want, &gamepad_state, VS_REPORT_SIZE);
+	gamepad_state.l_x_axis = 0x10;
+
+	while(tx_offset) {
+		vs_send_pad_state();
+		CHECK(host_poll());
+	}
+
+	size = 0;
+	for(int i = fetched - (tx_size + 7) / 8; i < fetched; i++) {
+		memcpy(report + size, PACKET(i).data, PACKET(i).len);
+		size += PACKET(i).len;
+	}
+
+	CHECK_EQ(size, ID_SIZE + VS_REPORT_SIZE);
+	CHECK(!ID_SIZE || report[0] == 1);
+	CHECK(!memcmp(report + ID_SIZE, want, VS_REPORT_SIZE));
+
+	// The change made during it is the next report, then nothing
+	CHECK_EQ(send_report(report), ID_SIZE + VS_REPORT_SIZE);
+	CHECK_EQ(report[ID_SIZE + offsetof(gamepad_state_t, l_x_axis)], 0x10);
+	CHECK_EQ(send_report(report), 0);
+
+	// Only the report's bytes are compared
+	gamepad_state.r2_axis ^= 0xFF;
+	CHECK_EQ(send_report(report), VS_REPORT_SIZE == sizeof(gamepad_state_t) ? VS_REPORT_SIZE : 0);
+
+	// SET_IDLE forces a report of every player and repeats them every
+	// period (4ms units)
+	set_idle(2);
+	CHECK_EQ(setup(USBRQ_TYPE_CLASS, USBRQ_HID_GET_IDLE, 0, 0, 1), 1);
+	CHECK_EQ(*usbMsgPtr, 2);
+	CHECK_EQ(drain(), VS_PLAYERS);
+
+	TCNT1 += TICKS_US(4000);
+	CHECK_EQ(drain(), 0);
+	TCNT1 += TICKS_US(4000) - 1;
+	CHECK_EQ(drain(), 0);
+	TCNT1 += 1;
+	CHECK_EQ(drain(), VS_PLAYERS);
+
+	// The longest period, 1020ms, is longer than the ticks' wrap
+	set_idle(255);
+	CHECK_EQ(drain(), VS_PLAYERS);
+
+	uint16_t start = TCNT1, elapsed = 0;
+	int reports;
+
+	for(int i = 0; i < 2000 && !(reports = drain()); i++) {
+		TCNT1 += 50;
+		elapsed = TCNT1 - start;
+	}
+
+	CHECK_EQ(reports, VS_PLAYERS);
+	CHECK(elapsed >= 255UL * TICKS_US(4000) && elapsed < 255UL * TICKS_US(4000) + 50);
+
+	// Back to reports on change only
+	set_idle(0);
+	CHECK_EQ(drain(), VS_PLAYERS);
+	TCNT1 += 40000;
+	CHECK_EQ(drain(), 0);
+	TCNT1 += 40000;
+	CHECK_EQ(drain(), 0);
+}
+
+static void check_waits() {
+	// Nothing queued: vs_wait_poll() returns at once
+	uint16_t start = TCNT1;
+	ticking = true;
+	vs_wait_poll();
+	CHECK((uint16_t)(TCNT1 - start) < 2);
+
+	// A queued packet the host doesn't fetch: it gives up after a bit more
+	// than one poll interval
+	gamepad_state.slider ^= 0xFF;
+	vs_send_pad_state();
+	start = TCNT1;
+	vs_wait_poll();
+	CHECK((uint16_t)(TCNT1 - start) >= TICKS_US(USB_CFG_INTR_POLL_INTERVAL * 1000UL));
+	CHECK(!usbInterruptIsReady());
+
+	// vs_wait_report() sends the rest of the report and forces player 1 on
+	// the next one
+	host_polling = true;
+	vs_wait_report();
+	host_polling = false;
+	ticking = false;
+	CHECK_EQ(tx_offset, 0);
+	CHECK(usbInterruptIsReady());
+
+	uchar report[64];
+	CHECK_EQ(send_report(report), ID_SIZE + VS_REPORT_SIZE);
+	CHECK_EQ(send_report(report), 0);
+}
+
+#if VS_PLAYERS > 1
+static void check_players() {
+	uchar report[64];
+	uchar seen = 0;
+
+	// All players are due: each goes once, with its ID and size
+	force_report = VS_ALL_PLAYERS;
+
+	for(uchar i = 0; i < VS_PLAYERS; i++) {
+		int size = send_report(report);
+
+		CHECK(report[0] >= 1 && report[0] <= VS_PLAYERS);
+		CHECK_EQ(size, 1 + report_size(report[0] - 1));
+		CHECK(!(seen & (1 << (report[0] - 1))));
+		seen |= 1 << (report[0] - 1);
+	}
+
+	CHECK_EQ(seen, VS_ALL_PLAYERS);
+	CHECK_EQ(send_report(report), 0);
+
+	// Player 1 changing on every report doesn't hold the last player off
+	vs_player_state(VS_PLAYERS - 1)->l_x_axis = 0x00;
+
+	for(uchar i = 0; i < VS_PLAYERS; i++) {
+		gamepad_state.l_y_axis++;
+		send_report(report);
+
+		if(report[0] == VS_PLAYERS)
+			break;
+	}
+
+	CHECK_EQ(report[0], VS_PLAYERS);
+	CHECK_EQ(report[1 + offsetof(gamepad_state_t, l_x_axis)], 0x00);
+
+	// Only the bytes the other players send are compared
+	drain();
+	vs_player_state(1)->r_x_axis = 0x00;
+	CHECK_EQ(drain(), 0);
+}
+#endif
+
+// Sends a SET_REPORT in 8 byte chunks, gives usbFunctionWrite()'s last answer
+static uchar set_report(uchar type, uchar id, uchar *data, uchar length) {
+	uchar result = 0;
+
+	CHECK_EQ(setup(USBRQ_TYPE_CLASS, USBRQ_HID_SET_REPORT, id, type, length), USB_NO_MSG);
+
+	for(uchar i = 0; i < length; i += 8)
+		result = usbFunctionWrite(data + i, length - i > 8 ? 8 : length - i);
+
+	return result;
+}
+
+static uchar get_feature(uchar id, uchar *data) {
+	usbMsgLen_t length = setup(USBRQ_TYPE_CLASS, USBRQ_HID_GET_REPORT, id, 0x03, VS_SETTINGS_REPORT_SIZE);
+
+	memcpy(data, usbMsgPtr, length);
+	return length;
+}
+
+static void flush_settings() {
+	for(int i = 0; i < 64; i++)
+		settings_task();
+}
+
+static void check_settings() {
+	uchar report[VS_SETTINGS_REPORT_SIZE], got[VS_SETTINGS_REPORT_SIZE];
+	uchar small, large;
+
+	// The PS3 magic feature report
+	CHECK_EQ(get_feature(0, got), 8);
+	CHECK_EQ(got[0], 0x21);
+	CHECK_EQ(got[1], 0x26);
+
+	// Remap of the pad in use: stored, applied and read back
+	report[0] = VS_REMAP_REPORT;
+	report[1] = padmap_current();
+
+	for(uchar i = 0; i < 16; i++)
+		report[2 + i] = 15 - i;
+
+	CHECK_EQ(set_report(0x03, VS_REMAP_REPORT, report, sizeof(report)), 1);
+
+	// A second write of the same report stalls until the first is in
+	CHECK_EQ(set_report(0x03, VS_REMAP_REPORT, report, sizeof(report)), 0xff);
+	flush_settings();
+
+	CHECK_EQ(padmap_source(0), 15);
+	CHECK_EQ(get_feature(VS_REMAP_REPORT, got), VS_SETTINGS_REPORT_SIZE);
+	CHECK(!memcmp(got, report, sizeof(report)));
+
+	// Another pad's table is stored without touching the one in use
+	report[1] = PADMAP_PADS - 1;
+	report[2] = 1;
+	report[3] = 0;
+	CHECK_EQ(set_report(0x03, VS_REMAP_REPORT, report, sizeof(report)), 1);
+	flush_settings();
+
+	padmap_read(PADMAP_PADS - 1, got);
+	CHECK_EQ(got[0], 1);
+	CHECK_EQ(got[1], 0);
+	CHECK_EQ(padmap_source(0), 15);
+
+	// Unknown pads and short reports are dropped
+	report[1] = PADMAP_PADS;
+	CHECK_EQ(set_report(0x03, VS_REMAP_REPORT, report, sizeof(report)), 1);
+	report[1] = padmap_current();
+	CHECK_EQ(set_report(0x03, VS_REMAP_REPORT, report, 10), 1);
+	CHECK(!settings_pending(report));
+	flush_settings();
+	CHECK_EQ(padmap_source(0), 15);
+
+	// Turbo rates, out of range ones read back as off
+	memset(report, 0, sizeof(report));
+	report[0] = VS_TURBO_REPORT;
+	report[1] = padmap_current();
+	report[2 + 2] = 10;
+	report[2 + 3] = TURBO_MAX_HZ + 1;
+	CHECK_EQ(set_report(0x03, VS_TURBO_REPORT, report, sizeof(report)), 1);
+	flush_settings();
+
+	CHECK_EQ(get_feature(VS_TURBO_REPORT, got), VS_SETTINGS_REPORT_SIZE);
+	CHECK_EQ(got[0], VS_TURBO_REPORT);
+	CHECK_EQ(got[2 + 2], 10);
+	CHECK_EQ(got[2 + 3], 0);
+
+	// SOCD mode in the first byte, the rest reads as zeros
+	memset(report, 0xAA, sizeof(report));
+	report[0] = VS_SOCD_REPORT;
+	report[1] = padmap_current();
+	report[2] = SOCD_LAST_WINS;
+	CHECK_EQ(set_report(0x03, VS_SOCD_REPORT, report, sizeof(report)), 1);
+	flush_settings();
+
+	CHECK_EQ(get_feature(VS_SOCD_REPORT, got), VS_SETTINGS_REPORT_SIZE);
+	CHECK_EQ(got[2], SOCD_LAST_WINS);
+	CHECK_EQ(got[3], 0);
+	CHECK_EQ(got[VS_SETTINGS_REPORT_SIZE - 1], 0);
+
+	// Other feature reports aren't taken
+	CHECK_EQ(setup(USBRQ_TYPE_CLASS, USBRQ_HID_GET_REPORT, VS_SOCD_REPORT + 1, 0x03, VS_SETTINGS_REPORT_SIZE), 0);
+	CHECK_EQ(setup(USBRQ_TYPE_CLASS, USBRQ_HID_SET_REPORT, VS_SOCD_REPORT + 1, 0x03, VS_SETTINGS_REPORT_SIZE), 0);
+
+	// Rumble output report: small motor in byte 3, large in byte 5, once
+	uchar rumble[6] = { 0x00, 0x00, 0xFE, 0x01, 0xFE, 0x80 };
+	CHECK(!vs_get_rumble(&small, &large));
+	CHECK_EQ(set_report(0x02, 0, rumble, sizeof(rumble)), 1);
+	CHECK(vs_get_rumble(&small, &large));
+	CHECK_EQ(small, 0x01);
+	CHECK_EQ(large, 0x80);
+	CHECK(!vs_get_rumble(&small, &large));
+}
+
+int main() {
+	char name[32];
+
+	memset(test_eeprom, 0xFF, sizeof(test_eeprom));
+	usbTxLen1 = USBPID_NAK;
+	padmap_load(0);
+	vs_reset_pad_status();
+
+	check_descriptor();
+
+	// Start from player 1's first report, the others sent
+	drain();
+	force_report = 1;
+
+	check_reports();
+	check_waits();
+#if VS_PLAYERS > 1
+	check_players();
+#endif
+	check_settings();
+
+	snprintf(name, sizeof(name), "usb (%d player%s%s)", VS_PLAYERS, VS_PLAYERS > 1 ? "s" : "",
+			USB_CFG_EXTRA_BUTTONS ? ", extra buttons" : "");
+	return test_done(name);
+}
@@ -0,0 +1,261 @@
+/*
+ * xbox/usbra: the XBOX button tables and D-PAD code against the per pad
+ * mapping code they replaced, on every raw button word. With erased EEPROM
+ * (no remap, turbo or SOCD) both must leave identical reports.
+ *
+ * The firmware's main file is included for its tables and helpers; the USB
+ * and GC/N64 drivers it calls are stubbed below.
+ */
+#include <string.h>
+#include <avr/eeprom.h>
+#include "test.h"
+#include "xbox/usbra.cpp"
+
+gamepad_state_t gamepad_state;
+
+void xbox_reset_pad_status() {}
+void xbox_init(bool watchdog) {}
+void xbox_reset_watchdog() {}
+void xbox_send_pad_state() {}
+int xbox_pad_detected() { return 1; }
+bool xbox_get_rumble(uint8_t *small, uint8_t *large) { return false; }
+int detectPad() { return PAD_WIICC; }
+bool detect_changed(bool idle) { return true; }
+byte GCPad_init() { return 0; }
+bool GCPad_origin() { return true; }
+byte GCPad_axis(byte axis, bool invert) { return 0x80; }
+byte *GCPad_read() { return 0; }
+byte *N64Pad_read() { return 0; }
+byte N64Pad_axis(byte axis, bool invert) { return 0x80; }
+void N64Pad_rumble(bool on) {}
+void N64Pad_pak_task() {}
+
+// bitSet() and bitClear(), as the old code used them
+#define OLD_BIT(bit, pressed) \
+	((pressed) ? (s->digital_buttons |= _BV(bit)) : (s->digital_buttons &= ~_BV(bit)))
+
+#define OLD_AXIS(axis, pressed) \
+	s->axis = ((pressed) > 0) * 0xFF
+
+static void old_dpad(gamepad_state_t *s, bool up, bool down, bool left, bool right) {
+	OLD_BIT(XBOX_DPAD_UP, up);
+	OLD_BIT(XBOX_DPAD_DOWN, down);
+	OLD_BIT(XBOX_DPAD_LEFT, left);
+	OLD_BIT(XBOX_DPAD_RIGHT, right);
+}
+
+static void old_genesis(uint16_t b, gamepad_state_t *s) {
+	old_dpad(s, b & GENESIS_UP, b & GENESIS_DOWN, b & GENESIS_LEFT, b & GENESIS_RIGHT);
+	OLD_AXIS(a, b & GENESIS_A);
+	OLD_AXIS(b, b & GENESIS_B);
+	OLD_AXIS(black, b & GENESIS_C);
+	OLD_AXIS(x, b & GENESIS_X);
+	OLD_AXIS(y, b & GENESIS_Y);
+	OLD_AXIS(white, b & GENESIS_Z);
+	OLD_BIT(XBOX_BACK, b & GENESIS_MODE);
+	OLD_BIT(XBOX_START, b & GENESIS_START);
+	OLD_BIT(XBOX_RIGHT_STICK, (b & GENESIS_UP) && (b & GENESIS_START));
+}
+
+static void old_arcade(uint16_t b, gamepad_state_t *s) {
+	old_dpad(s, b & 0x01, b & 0x02, b & 0x04, b & 0x08);
+	OLD_AXIS(x, b & 0x10);
+	OLD_AXIS(a, b & 0x20);
+	OLD_AXIS(y, b & 0x40);
+	OLD_AXIS(b, b & 0x80);
+	OLD_AXIS(white, b & 0x100);
+	OLD_AXIS(black, b & 0x200);
+	OLD_AXIS(l, b & 0x400);
+	OLD_AXIS(r, b & 0x800);
+	OLD_BIT(XBOX_BACK, b & 0x1000);
+	OLD_BIT(XBOX_START, b & 0x2000);
+	OLD_BIT(XBOX_LEFT_STICK, b & 0x4000);
+	OLD_BIT(XBOX_RIGHT_STICK, b & 0x8000);
+}
+
+static void old_nes(uint16_t b, gamepad_state_t *s) {
+	old_dpad(s, b & 16, b & 32, b & 64, b & 128);
+	OLD_AXIS(b, b & 2);
+	OLD_AXIS(a, b & 1);
+	OLD_BIT(XBOX_BACK, b & 4);
+	OLD_BIT(XBOX_START, b & 8);
+	OLD_BIT(XBOX_RIGHT_STICK, (b & 4) && (b & 8));
+}
+
+static void old_snes(uint16_t b, gamepad_state_t *s) {
+	old_dpad(s, b & 16, b & 32, b & 64, b & 128);
+	OLD_AXIS(a, b & 1);
+	OLD_AXIS(b, b & 256);
+	OLD_AXIS(x, b & 2);
+	OLD_AXIS(y, b & 512);
+	OLD_AXIS(l, b & 1024);
+	OLD_AXIS(r, b & 2048);
+	OLD_BIT(XBOX_BACK, b & 4);
+	OLD_BIT(XBOX_START, b & 8);
+	OLD_BIT(XBOX_RIGHT_STICK, (b & 4) && (b & 8));
+}
+
+// Sticks left out
+static void old_ps2(uint16_t b, gamepad_state_t *s) {
+	old_dpad(s, b & PSB_PAD_UP, b & PSB_PAD_DOWN, b & PSB_PAD_LEFT, b & PSB_PAD_RIGHT);
+	OLD_AXIS(x, b & PSB_SQUARE);
+	OLD_AXIS(y, b & PSB_TRIANGLE);
+	OLD_AXIS(a, b & PSB_CROSS);
+	OLD_AXIS(b, b & PSB_CIRCLE);
+	OLD_BIT(XBOX_START, b & PSB_START);
+	OLD_BIT(XBOX_BACK, b & PSB_SELECT);
+	OLD_BIT(XBOX_LEFT_STICK, b & PSB_L3);
+	OLD_BIT(XBOX_RIGHT_STICK, b & PSB_R3);
+	OLD_AXIS(l, b & PSB_L2);
+	OLD_AXIS(r, b & PSB_R2);
+	OLD_AXIS(white, b & PSB_L1);
+	OLD_AXIS(black, b & PSB_R1);
+}
+
+// GC, the raw word is button_data[0] << 8 | button_data[1]; sticks left out
+static void old_gc(uint16_t b, gamepad_state_t *s) {
+	uint8_t b0 = b >> 8, b1 = b;
+
+	old_dpad(s, b1 & 0x08, b1 & 0x04, b1 & 0x01, b1 & 0x02);
+	OLD_AXIS(x, b0 & 0x08);
+	OLD_AXIS(a, b0 & 0x02);
+	OLD_AXIS(y, b0 & 0x04);
+	OLD_AXIS(b, b0 & 0x01);
+	OLD_BIT(XBOX_START, b0 & 0x10);
+	OLD_AXIS(l, b1 & 0x40);
+	OLD_AXIS(r, b1 & 0x20);
+	OLD_AXIS(black, b1 & 0x10);
+	OLD_BIT(XBOX_RIGHT_STICK, (b1 & 0x08) && (b0 & 0x10));
+}
+
+// N64, same raw word; the left stick and C buttons left out
+static void old_n64(uint16_t b, gamepad_state_t *s) {
+	uint8_t b0 = b >> 8, b1 = b;
+
+	old_dpad(s, b0 & 0x08, b0 & 0x04, b0 & 0x02, b0 & 0x01);
+	OLD_AXIS(x, b0 & 0x40);
+	OLD_AXIS(a, b0 & 0x80);
+	OLD_BIT(XBOX_START, b0 & 0x10);
+	OLD_AXIS(l, b1 & 0x20);
+	OLD_AXIS(r, b1 & 0x10);
+	OLD_AXIS(black, b0 & 0x20);
+	OLD_BIT(XBOX_RIGHT_STICK, (b0 & 0x08) && (b0 & 0x10));
+}
+
+static void old_neogeo(uint16_t b, gamepad_state_t *s) {
+	old_dpad(s, b & 0x04, b & 0x1000, b & 0x02, b & 0x800);
+	OLD_AXIS(x, b & 0x8000);
+	OLD_AXIS(a, b & 0x01);
+	OLD_AXIS(b, b & 0x400);
+	OLD_AXIS(y, b & 0x200);
+	OLD_BIT(XBOX_BACK, b & 0x100);
+	OLD_BIT(XBOX_START, b & 0x4000);
+	OLD_BIT(XBOX_RIGHT_STICK, (b & 0x100) && (b & 0x4000));
+}
+
+static void old_saturn(uint16_t b, gamepad_state_t *s) {
+	old_dpad(s, b & SATURN_UP, b & SATURN_DOWN, b & SATURN_LEFT, b & SATURN_RIGHT);
+	OLD_AXIS(a, b & SATURN_A);
+	OLD_AXIS(b, b & SATURN_B);
+	OLD_AXIS(black, b & SATURN_C);
+	OLD_AXIS(x, b & SATURN_X);
+	OLD_AXIS(y, b & SATURN_Y);
+	OLD_AXIS(white, b & SATURN_Z);
+	OLD_AXIS(l, b & SATURN_L);
+	OLD_AXIS(r, b & SATURN_R);
+	OLD_BIT(XBOX_START, b & SATURN_START);
+	OLD_BIT(XBOX_RIGHT_STICK, (b & SATURN_UP) && (b & SATURN_START));
+}
+
+static void old_tg16(uint16_t b, gamepad_state_t *s) {
+	old_dpad(s, b & (1 << TG16_UP), b & (1 << TG16_DOWN), b & (1 << TG16_LEFT), b & (1 << TG16_RIGHT));
+	OLD_AXIS(a, b & (1 << TG16_I));
+	OLD_AXIS(x, b & (1 << TG16_II));
+	OLD_BIT(XBOX_START, b & (1 << TG16_RUN));
+	OLD_BIT(XBOX_BACK, b & (1 << TG16_SELECT));
+	OLD_BIT(XBOX_RIGHT_STICK, (b & (1 << TG16_RUN)) && (b & (1 << TG16_SELECT)));
+}
+
+// The mapping steps of the loops. set_dpad() works on gamepad_state, so the
+// new code runs there and its result is copied out.
+static void new_mapping(const padmap_t *map, uint16_t up, uint16_t down, uint16_t left, uint16_t right,
+		uint16_t b, gamepad_state_t *s) {
+	gamepad_state = *s;
+
+	set_dpad(socd_resolve(padmap_dir(b, up, down, left, right)));
+	padmap_apply(map, b, (uint8_t *) &gamepad_state);
+
+	*s = gamepad_state;
+}
+
+#define NEW_DIGITAL(name, driver, map) \
+	static void name(uint16_t b, gamepad_state_t *s) { \
+		new_mapping(map, driver::up, driver::down, driver::left, driver::right, b, s); \
+	}
+
+NEW_DIGITAL(new_genesis, GenesisDriver, genesis_map)
+NEW_DIGITAL(new_arcade, ArcadeDriver, arcade_map)
+NEW_DIGITAL(new_nes, NESDriver, nes_map)
+NEW_DIGITAL(new_snes, SNESDriver, snes_map)
+NEW_DIGITAL(new_neogeo, NeoGeoDriver, neogeo_map)
+NEW_DIGITAL(new_saturn, SaturnDriver, saturn_map)
+NEW_DIGITAL(new_tg16, TG16Driver, tg16_map)
+
+static void new_ps2(uint16_t b, gamepad_state_t *s) {
+	new_mapping(ps2_map, PSB_PAD_UP, PSB_PAD_DOWN, PSB_PAD_LEFT, PSB_PAD_RIGHT, b, s);
+}
+
+static void new_gc(uint16_t b, gamepad_state_t *s) {
+	new_mapping(gc_map, 0x0008, 0x0004, 0x0001, 0x0002, b, s);
+}
+
+static void new_n64(uint16_t b, gamepad_state_t *s) {
+	new_mapping(n64_map, 0x0800, 0x0400, 0x0200, 0x0100, b, s);
+}
+
+typedef void (*map_fn)(uint16_t b, gamepad_state_t *s);
+
+// Every raw word, each over reports that start cleared, set and patterned
+static uint32_t mismatches(uint8_t pad, map_fn old_map, map_fn new_map) {
+	static const uint8_t fills[] = { 0x00, 0xFF, 0xA5 };
+	gamepad_state_t want, got;
+	uint32_t bad = 0;
+
+	padmap_load(pad);
+
+	for(uint8_t f = 0; f < sizeof(fills); f++) {
+		for(uint32_t b = 0; b <= 0xFFFF; b++) {
+			memset(&want, fills[f], sizeof(want));
+			memset(&got, fills[f], sizeof(got));
+
+			old_map(b, &want);
+			new_map(b, &got);
+
+			if(memcmp(&want, &got, sizeof(want))) {
+				if(!bad)
+					printf("pad %u, buttons %04X, fill %02X differs\n", pad, (unsigned) b, fills[f]);
+
+				bad++;
+			}
+		}
+	}
+
+	return bad;
+}
+
+int main() {
+	memset(test_eeprom, 0xFF, sizeof(test_eeprom));
+
+	CHECK_EQ(mismatches(PADMAP_GENESIS, old_genesis, new_genesis), 0);
+	CHECK_EQ(mismatches(PADMAP_ARCADE, old_arcade, new_arcade), 0);
+	CHECK_EQ(mismatches(PADMAP_NES, old_nes, new_nes), 0);
+	CHECK_EQ(mismatches(PADMAP_SNES, old_snes, new_snes), 0);
+	CHECK_EQ(mismatches(PADMAP_NEOGEO, old_neogeo, new_neogeo), 0);
+	CHECK_EQ(mismatches(PADMAP_SATURN, old_saturn, new_saturn), 0);
+	CHECK_EQ(mismatches(PADMAP_TG16, old_tg16, new_tg16), 0);
+	CHECK_EQ(mismatches(PADMAP_PS2, old_ps2, new_ps2), 0);
+	CHECK_EQ(mismatches(PADMAP_GC, old_gc, new_gc), 0);
+	CHECK_EQ(mismatches(PADMAP_N64, old_n64, new_n64), 0);
+
+	return test_done("xbox_maps");
+}
@@ -0,0 +1,265 @@
+/*
+* USB RetroPad Adapter - PC/PS3 USB adapter for retro-controllers!
+* Copyright (c) 2012 Bruno Freitas - bruno@brunofreitas.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * usbra-remap - reads and changes the button remap, turbo and SOCD settings of a
+ * USB RetroPad Adapter (PC/PS3 firmware) through its feature reports on Linux.
+ *
+ * Build: cc -o usbra-remap usbra-remap.c
+ *
+ * Usage:
+ *   usbra-remap /dev/hidrawN [turbo]                 show the table of the pad in use
+ *   usbra-remap /dev/hidrawN PAD [turbo] reset       clear the table of PAD
+ *   usbra-remap /dev/hidrawN PAD [turbo] V0 ... V15  set the table of PAD
+ *   usbra-remap /dev/hidrawN socd                    show the SOCD mode of the pad in use
+ *   usbra-remap /dev/hidrawN PAD socd MODE           set the SOCD mode of PAD
+ *
+ * PAD is a pad name (arcade, genesis, nes, snes, ps2, gc, n64, neogeo, saturn,
+ * tg16) or its number. In the remap table, bit i of the pad's raw button word
+ * takes the state of raw bit Vi, so "0 1 2 ... 15" is the identity. In the
+ * turbo table, Vi is the autofire rate of raw bit i in Hz (5 to 30), 0 for
+ * none. MODE is how opposing directions pressed together resolve: neutral,
+ * last (last pressed wins), up (up wins, left + right is neutral) or off
+ * (the pad's own behaviour). Settings are kept in the adapter's EEPROM;
+ * settings for the pad in use apply immediately.
+ *
+ * Only the multi-player builds, except 4 players with extra buttons, declare
+ * the settings feature reports (see usbconfig.h). The tool checks the report
+ * descriptor first and refuses to talk to other builds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/hidraw.h>
+
+/* Must match the VS_*_REPORT definitions in USBVirtuaStick.h */
+#define REMAP_REPORT		0x10
+#define TURBO_REPORT		0x11
+#define SOCD_REPORT			0x12
+#define SETTINGS_REPORT_SIZE	18
+
+static const char *pads[] = {
+	"arcade", "genesis", "nes", "snes", "ps2", "gc", "n64", "neogeo", "saturn", "tg16"
+};
+
+#define PADS (sizeof(pads) / sizeof(pads[0]))
+
+/* Index is the SOCD_* value in socd.h, off is 0xFF */
+static const char *socd_modes[] = { "neutral", "last", "up" };
+
+#define SOCD_MODES (sizeof(socd_modes) / sizeof(socd_modes[0]))
+#define SOCD_OFF 0xFF
+
+static int socd_mode(const char *name) {
+	for(unsigned int i = 0; i < SOCD_MODES; i++) {
+		if(!strcmp(name, socd_modes[i]))
+			return i;
+	}
+
+	if(!strcmp(name, "off") || !strcmp(name, "reset"))
+		return SOCD_OFF;
+
+	return -1;
+}
+
+static int pad_number(const char *name) {
+	char *end;
+	long n;
+
+	for(unsigned int i = 0; i < PADS; i++) {
+		if(!strcmp(name, pads[i]))
+			return i;
+	}
+
+	n = strtol(name, &end, 0);
+
+	if(*end || n < 0 || n >= (long) PADS)
+		return -1;
+
+	return n;
+}
+
+/* Walks the report descriptor for a feature item under REMAP_REPORT */
+static int has_settings(int fd) {
+	struct hidraw_report_descriptor desc;
+	unsigned int i = 0, report_id = 0;
+	int size;
+
+	if(ioctl(fd, HIDIOCGRDESCSIZE, &size) < 0)
+		return -1;
+
+	desc.size = size;
+
+	if(ioctl(fd, HIDIOCGRDESC, &desc) < 0)
+		return -1;
+
+	while(i < desc.size) {
+		unsigned char prefix = desc.value[i];
+		unsigned int length;
+
+		if(prefix == 0xFE) {
+			// Long item: data size, tag, data
+			if(i + 1 >= desc.size)
+				break;
+
+			i += 3 + desc.value[i + 1];
+			continue;
+		}
+
+		length = (prefix & 3) == 3 ? 4 : prefix & 3;
+
+		if(i + length >= desc.size)
+			break;
+
+		if((prefix & 0xFC) == 0x84) // REPORT_ID
+			report_id = desc.value[i + 1];
+		else if((prefix & 0xFC) == 0xB0 && report_id == REMAP_REPORT) // FEATURE
+			return 1;
+
+		i += 1 + length;
+	}
+
+	return 0;
+}
+
+static int usage(const char *argv0) {
+	fprintf(stderr, "usage: %s /dev/hidrawN [PAD] [turbo] [reset | V0 ... V15]\n"
+			"       %s /dev/hidrawN [PAD] socd [neutral | last | up | off]\n", argv0, argv0);
+	return 2;
+}
+
+static int valid(int turbo, long value) {
+	if(turbo)
+		return value == 0 || (value >= 5 && value <= 30);
+
+	return value >= 0 && value <= 15;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned char report[SETTINGS_REPORT_SIZE];
+	int fd, pad = -1, turbo = 0, socd = 0, arg = 2;
+
+	if(argc < 2)
+		return usage(argv[0]);
+
+	if(arg < argc && strcmp(argv[arg], "turbo") && strcmp(argv[arg], "socd")) {
+		pad = pad_number(argv[arg]);
+
+		if(pad < 0) {
+			fprintf(stderr, "%s: unknown pad\n", argv[arg]);
+			return 2;
+		}
+
+		arg++;
+	}
+
+	if(arg < argc && !strcmp(argv[arg], "turbo")) {
+		turbo = 1;
+		arg++;
+	} else if(arg < argc && !strcmp(argv[arg], "socd")) {
+		socd = 1;
+		arg++;
+	}
+
+	// Show needs no pad, set needs one and either "reset" or 16 values (one
+	// mode for SOCD)
+	if(pad < 0 ? arg != argc : (argc - arg != 1 && (socd || argc - arg != 16)))
+		return usage(argv[0]);
+
+	if(pad >= 0 && socd && socd_mode(argv[arg]) < 0) {
+		fprintf(stderr, "%s: mode must be neutral, last, up or off\n", argv[arg]);
+		return 2;
+	}
+
+	if(argc - arg == 1 && !socd && strcmp(argv[arg], "reset"))
+		return usage(argv[0]);
+
+	fd = open(argv[1], O_RDWR);
+
+	if(fd < 0) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	switch(has_settings(fd)) {
+	case -1:
+		perror("HIDIOCGRDESC");
+		return 1;
+	case 0:
+		fprintf(stderr, "%s: this firmware build has no settings reports (single player or 4 players with extra buttons)\n", argv[1]);
+		return 1;
+	}
+
+	report[0] = socd ? SOCD_REPORT : turbo ? TURBO_REPORT : REMAP_REPORT;
+
+	if(pad < 0) {
+		memset(report + 1, 0, sizeof(report) - 1);
+
+		if(ioctl(fd, HIDIOCGFEATURE(sizeof(report)), report) < 0) {
+			perror("HIDIOCGFEATURE");
+			return 1;
+		}
+
+		printf("%s:", report[1] < PADS ? pads[report[1]] : "?");
+
+		if(socd) {
+			printf(" %s", report[2] < SOCD_MODES ? socd_modes[report[2]] : "off");
+		} else {
+			for(int i = 0; i < 16; i++)
+				printf(" %d", report[2 + i]);
+		}
+
+		printf("\n");
+		return 0;
+	}
+
+	report[1] = pad;
+
+	if(socd) {
+		memset(report + 2, 0, sizeof(report) - 2);
+		report[2] = socd_mode(argv[arg]);
+	}
+
+	for(int i = 0; !socd && i < 16; i++) {
+		if(argc - arg == 1) {
+			report[2 + i] = turbo ? 0 : i;
+		} else {
+			char *end;
+			long value = strtol(argv[arg + i], &end, 0);
+
+			if(*end || !valid(turbo, value)) {
+				fprintf(stderr, "%s: %s\n", argv[arg + i], turbo ? "rate must be 0 or 5..30" : "raw bit must be 0..15");
+				return 2;
+			}
+
+			report[2 + i] = value;
+		}
+	}
+
+	if(ioctl(fd, HIDIOCSFEATURE(sizeof(report)), report) < 0) {
+		perror("HIDIOCSFEATURE");
+		return 1;
+	}
+
+	close(fd);
+	return 0;
+}